@@ -5,6 +5,82 @@
 
 #define SOURCE_FOLDER "./src/"
 #define BUILD_FOLDER "./build/"
+#define TESTS_FOLDER "./tests/"
+#define TESTS_BUILD_FOLDER BUILD_FOLDER"tests/"
+
+// every tests/<name>.c goes through cerdeb and runs with the path of a log as
+// argument, a test that writes that log prints the text cerdeb-decode has to
+// give for it on stdout
+static const char* tests[] = {
+    "printers",
+    "log",
+    "log_threads",
+    "follow",
+    "async",
+    "flight",
+    "diff",
+    "levels",
+    "levels_off",
+    "dispatch",
+    "cache",
+};
+
+// the sanitizers catch the overflows the outputs alone don't show
+#define TEST_FLAGS "-Wall", "-Wextra", "-Werror", "-ggdb", "-fsanitize=address,undefined", "-pthread"
+
+bool run_test(Cmd* cmd, const char* name) {
+    const char* bin = temp_sprintf("%s%s", TESTS_BUILD_FOLDER, name);
+    const char* log = temp_sprintf("%s.log", bin);
+    const char* out = temp_sprintf("%s.out", bin);
+    const char* decoded = temp_sprintf("%s.decoded", bin);
+
+    cmd_append(cmd, BUILD_FOLDER"cerdeb", temp_sprintf("%s%s.c", TESTS_FOLDER, name), TEST_FLAGS);
+    cmd_append(cmd, "-I./extern", "-I"TESTS_FOLDER, "-o", bin);
+    if (!cmd_run(cmd)) return false;
+
+    if (file_exists(log) == 1 && !delete_file(log)) return false;
+    cmd_append(cmd, bin, log);
+    if (!cmd_run(cmd, .stdout_path = out)) return false;
+    if (file_exists(log) != 1) return true;
+
+    // cerdeb.meta is the one of the last generated test
+    cmd_append(cmd, TESTS_BUILD_FOLDER"cerdeb-decode", "./output/cerdeb.meta", log);
+    if (!cmd_run(cmd, .stdout_path = decoded)) return false;
+
+    String_Builder expected = {0};
+    String_Builder actual = {0};
+    if (!read_entire_file(out, &expected) || !read_entire_file(decoded, &actual)) return false;
+    bool same = expected.count == actual.count && memcmp(expected.items, actual.items, expected.count) == 0;
+    if (!same) nob_log(ERROR, "%s: the decoded log %s differs from %s", name, decoded, out);
+    sb_free(expected);
+    sb_free(actual);
+    return same;
+}
+
+bool run_tests(Cmd* cmd) {
+    if (!mkdir_if_not_exists(TESTS_BUILD_FOLDER)) return false;
+
+    nob_cc(cmd);
+    cmd_append(cmd, TEST_FLAGS, "-O2");
+    nob_cc_inputs(cmd, SOURCE_FOLDER"decode.c");
+    nob_cc_output(cmd, TESTS_BUILD_FOLDER"cerdeb-decode");
+    if (!cmd_run(cmd)) return false;
+
+    size_t failed = 0;
+    for (size_t i = 0; i < ARRAY_LEN(tests); ++i) {
+        if (run_test(cmd, tests[i])) {
+            nob_log(INFO, "test %s: OK", tests[i]);
+        } else {
+            nob_log(ERROR, "test %s: FAILED", tests[i]);
+            cmd->count = 0;
+            failed += 1;
+        }
+        temp_reset();
+    }
+
+    nob_log(failed ? ERROR : INFO, "%zu/%zu tests passed", ARRAY_LEN(tests) - failed, ARRAY_LEN(tests));
+    return failed == 0;
+}
 
 int main(int argc, char** argv) {
     NOB_GO_REBUILD_URSELF(argc, argv);
@@ -23,6 +99,18 @@ int main(int argc, char** argv) {
         nob_log(NOB_INFO, "Up to date");
     }
 
+    const char* decode_inputs[] = { SOURCE_FOLDER"decode.c", SOURCE_FOLDER"cerdeb.h" };
+    if (needs_rebuild(BUILD_FOLDER"cerdeb-decode", decode_inputs, ARRAY_LEN(decode_inputs))) {
+        nob_cc(&cmd);
+        nob_cc_flags(&cmd);
+        cmd_append(&cmd, "-O2", "-pthread");
+        nob_cc_inputs(&cmd, SOURCE_FOLDER"decode.c");
+        nob_cc_output(&cmd, BUILD_FOLDER"cerdeb-decode");
+        if (!cmd_run(&cmd)) return 1;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "test") == 0) return run_tests(&cmd) ? 0 : 1;
+
     cmd_append(&cmd, BUILD_FOLDER"cerdeb");
     for (int i = 1; i < argc; ++i) cmd_append(&cmd, argv[i]);
     if (!cmd_run(&cmd)) return 1;
@@ -0,0 +1,1953 @@
+// cerdeb.h - runtime support for the code generated by cerdeb
+//
+// The generated printers format every field with the straight-line routines
+// below instead of going through printf. Every routine writes at `p` and
+// returns the position right after what it wrote, the caller is responsible
+// for providing enough room (see the CERDEB_*_MAX_LEN constants).
+//
+// cerdeb copies this file next to the generated sources and includes it
+// before the first derived struct of every file. The few parts that need
+// global state live behind CERDEB_IMPLEMENTATION, which cerdeb defines at
+// the end of the first source file it generates.
+
+#ifndef CERDEB_H_
+#define CERDEB_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#define CERDEB_THREAD_LOCAL __declspec(thread)
+#else
+#define CERDEB_THREAD_LOCAL _Thread_local
+#endif
+
+// The generated printers are kept away from the hot code: they are never
+// inlined and live in their own section, the cold ones are also optimized for
+// size and their calls are treated as unlikely. The batch printers are only
+// moved out of line, they are throughput code.
+//
+// `cerdeb --gc-sections` compiles with CERDEB_SPLIT_SECTIONS and
+// -ffunction-sections instead, every printer keeps its own section so the
+// linker can drop the unreferenced ones. The printers of headers are weak,
+// the translation units including the header share one copy.
+#if defined(__GNUC__) || defined(__clang__)
+#define CERDEB_WEAK __attribute__((weak))
+#if defined(__ELF__) && !defined(CERDEB_SPLIT_SECTIONS)
+#define CERDEB__SECTION __attribute__((section(".text.cerdeb")))
+#else
+#define CERDEB__SECTION
+#endif
+#define CERDEB_OUT_OF_LINE __attribute__((noinline)) CERDEB__SECTION
+#define CERDEB_COLD __attribute__((cold)) CERDEB_OUT_OF_LINE
+#elif defined(_MSC_VER)
+#define CERDEB_WEAK
+#define CERDEB_OUT_OF_LINE __declspec(noinline)
+#define CERDEB_COLD CERDEB_OUT_OF_LINE
+#else
+#define CERDEB_WEAK
+#define CERDEB_OUT_OF_LINE
+#define CERDEB_COLD
+#endif
+
+#define CERDEB_I32_MAX_LEN 11
+#define CERDEB_I64_MAX_LEN 20
+#define CERDEB_U32_MAX_LEN 10
+#define CERDEB_U64_MAX_LEN 20
+#define CERDEB_PTR_MAX_LEN 18
+#define CERDEB_CHAR_MAX_LEN 1
+// "-0.0000012345678901234567" and "-100000000000000000000.0"
+#define CERDEB_F64_MAX_LEN 25
+#define CERDEB_F32_MAX_LEN 24
+
+static const char cerdeb__digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const uint64_t cerdeb__pow10[20] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+    10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+    100000000000ull, 1000000000000ull, 10000000000000ull,
+    100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+    100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull,
+};
+
+static inline char* cerdeb_write_lit(char* p, const char* lit, size_t len) {
+    memcpy(p, lit, len);
+    return p + len;
+}
+
+static inline size_t cerdeb_u64_len(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    // log10(v) ~= log2(v) * 1233 / 4096, corrected by one table lookup
+    v |= 1;
+    size_t bits = 64 - __builtin_clzll(v);
+    size_t len = (bits * 1233) >> 12;
+    return len + (v >= cerdeb__pow10[len]);
+#else
+    size_t len = 1;
+    while (len < 20 && v >= cerdeb__pow10[len]) ++len;
+    return len;
+#endif
+}
+
+static inline char* cerdeb_write_u64(char* p, uint64_t v) {
+    size_t len = cerdeb_u64_len(v);
+    char* end = p + len;
+
+    while (v >= 100) {
+        size_t pair = (size_t)(v % 100) * 2;
+        v /= 100;
+        end -= 2;
+        end[0] = cerdeb__digit_pairs[pair];
+        end[1] = cerdeb__digit_pairs[pair + 1];
+    }
+
+    if (v >= 10) {
+        p[0] = cerdeb__digit_pairs[v * 2];
+        p[1] = cerdeb__digit_pairs[v * 2 + 1];
+    } else {
+        p[0] = (char)('0' + v);
+    }
+
+    return p + len;
+}
+
+static inline char* cerdeb_write_i64(char* p, int64_t v) {
+    uint64_t u = (uint64_t)v;
+    if (v < 0) {
+        *p++ = '-';
+        u = 0 - u;
+    }
+    return cerdeb_write_u64(p, u);
+}
+
+static inline char* cerdeb_write_i32(char* p, int32_t v) {
+    return cerdeb_write_i64(p, v);
+}
+
+static inline char* cerdeb_write_char(char* p, char c) {
+    *p = c;
+    return p + 1;
+}
+
+// Same output as glibc's "%p"
+static inline char* cerdeb_write_ptr(char* p, const void* ptr) {
+    static const char hex[] = "0123456789abcdef";
+    uintptr_t v = (uintptr_t)ptr;
+    if (v == 0) return cerdeb_write_lit(p, "(nil)", 5);
+
+    size_t len = 0;
+    for (uintptr_t t = v; t != 0; t >>= 4) ++len;
+
+    *p++ = '0';
+    *p++ = 'x';
+    for (size_t i = len; i > 0; --i, v >>= 4) p[i - 1] = hex[v & 0xf];
+    return p + len;
+}
+
+// Same output as glibc's "%s", NULL is printed as "(null)"
+static inline size_t cerdeb_str_len(const char* s) {
+    return s ? strlen(s) : 6;
+}
+
+static inline char* cerdeb_write_str(char* p, const char* s) {
+    if (s == NULL) return cerdeb_write_lit(p, "(null)", 6);
+    return cerdeb_write_lit(p, s, strlen(s));
+}
+
+// `!hex` integers, "%#x" without the special case of 0
+#define CERDEB_HEX32_MAX_LEN 10
+#define CERDEB_HEX64_MAX_LEN 18
+
+static inline char* cerdeb_write_hex(char* p, uint64_t v) {
+    static const char hex[] = "0123456789abcdef";
+    size_t len = 1;
+    for (uint64_t t = v >> 4; t != 0; t >>= 4) ++len;
+
+    *p++ = '0';
+    *p++ = 'x';
+    for (size_t i = len; i > 0; --i, v >>= 4) p[i - 1] = hex[v & 0xf];
+    return p + len;
+}
+
+// `!len(field)` and `!max(N)` strings, the first `n` characters of `s`
+#define CERDEB_STR_MAX_LEN(max) ((size_t)(max) > 6 ? (size_t)(max) : 6)
+
+static inline size_t cerdeb_strn_len(const char* s, size_t n) {
+    return s ? n : 6;
+}
+
+// at most `max` characters, without reading past them
+static inline size_t cerdeb_str_len_max(const char* s, size_t max) {
+    if (s == NULL) return 0;
+    const char* end = (const char*)memchr(s, '\0', max);
+    return end ? (size_t)(end - s) : max;
+}
+
+static inline char* cerdeb_write_strn(char* p, const char* s, size_t n) {
+    if (s == NULL) return cerdeb_write_lit(p, "(null)", 6);
+    return cerdeb_write_lit(p, s, n);
+}
+
+// Shortest round-trip formatting of floats and doubles (Grisu2).
+//
+// The digits parse back to the same value and are the shortest ones that do
+// for all but a few inputs (Grisu2 stays inside the rounding interval, so next
+// to its boundaries it can give a longer, still correct, result). Doubles are
+// printed with at most 17 significant digits and floats with at most 9.
+//
+// Values in [1e-6, 1e21) are printed in decimal notation, the others in
+// scientific notation: 0.1, 1.0, 123.456, 1e-7, 1.5e300.
+
+typedef struct {
+    uint64_t f;
+    int e;
+} Cerdeb_Diy_Fp;
+
+static const uint64_t cerdeb__cached_powers_f[] = {
+    0xfa8fd5a0081c0288ull, 0xbaaee17fa23ebf76ull, 0x8b16fb203055ac76ull, 0xcf42894a5dce35eaull,
+    0x9a6bb0aa55653b2dull, 0xe61acf033d1a45dfull, 0xab70fe17c79ac6caull, 0xff77b1fcbebcdc4full,
+    0xbe5691ef416bd60cull, 0x8dd01fad907ffc3cull, 0xd3515c2831559a83ull, 0x9d71ac8fada6c9b5ull,
+    0xea9c227723ee8bcbull, 0xaecc49914078536dull, 0x823c12795db6ce57ull, 0xc21094364dfb5637ull,
+    0x9096ea6f3848984full, 0xd77485cb25823ac7ull, 0xa086cfcd97bf97f4ull, 0xef340a98172aace5ull,
+    0xb23867fb2a35b28eull, 0x84c8d4dfd2c63f3bull, 0xc5dd44271ad3cdbaull, 0x936b9fcebb25c996ull,
+    0xdbac6c247d62a584ull, 0xa3ab66580d5fdaf6ull, 0xf3e2f893dec3f126ull, 0xb5b5ada8aaff80b8ull,
+    0x87625f056c7c4a8bull, 0xc9bcff6034c13053ull, 0x964e858c91ba2655ull, 0xdff9772470297ebdull,
+    0xa6dfbd9fb8e5b88full, 0xf8a95fcf88747d94ull, 0xb94470938fa89bcfull, 0x8a08f0f8bf0f156bull,
+    0xcdb02555653131b6ull, 0x993fe2c6d07b7facull, 0xe45c10c42a2b3b06ull, 0xaa242499697392d3ull,
+    0xfd87b5f28300ca0eull, 0xbce5086492111aebull, 0x8cbccc096f5088ccull, 0xd1b71758e219652cull,
+    0x9c40000000000000ull, 0xe8d4a51000000000ull, 0xad78ebc5ac620000ull, 0x813f3978f8940984ull,
+    0xc097ce7bc90715b3ull, 0x8f7e32ce7bea5c70ull, 0xd5d238a4abe98068ull, 0x9f4f2726179a2245ull,
+    0xed63a231d4c4fb27ull, 0xb0de65388cc8ada8ull, 0x83c7088e1aab65dbull, 0xc45d1df942711d9aull,
+    0x924d692ca61be758ull, 0xda01ee641a708deaull, 0xa26da3999aef774aull, 0xf209787bb47d6b85ull,
+    0xb454e4a179dd1877ull, 0x865b86925b9bc5c2ull, 0xc83553c5c8965d3dull, 0x952ab45cfa97a0b3ull,
+    0xde469fbd99a05fe3ull, 0xa59bc234db398c25ull, 0xf6c69a72a3989f5cull, 0xb7dcbf5354e9beceull,
+    0x88fcf317f22241e2ull, 0xcc20ce9bd35c78a5ull, 0x98165af37b2153dfull, 0xe2a0b5dc971f303aull,
+    0xa8d9d1535ce3b396ull, 0xfb9b7cd9a4a7443cull, 0xbb764c4ca7a44410ull, 0x8bab8eefb6409c1aull,
+    0xd01fef10a657842cull, 0x9b10a4e5e9913129ull, 0xe7109bfba19c0c9dull, 0xac2820d9623bf429ull,
+    0x80444b5e7aa7cf85ull, 0xbf21e44003acdd2dull, 0x8e679c2f5e44ff8full, 0xd433179d9c8cb841ull,
+    0x9e19db92b4e31ba9ull, 0xeb96bf6ebadf77d9ull, 0xaf87023b9bf0ee6bull,
+};
+
+static const int16_t cerdeb__cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954,
+    -927, -901, -874, -847, -821, -794, -768, -741, -715, -688, -661,
+    -635, -608, -582, -555, -529, -502, -475, -449, -422, -396, -369,
+    -343, -316, -289, -263, -236, -210, -183, -157, -130, -103, -77,
+    -50, -24, 3, 30, 56, 83, 109, 136, 162, 189, 216,
+    242, 269, 295, 322, 348, 375, 402, 428, 455, 481, 508,
+    534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800,
+    827, 853, 880, 907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static inline Cerdeb_Diy_Fp cerdeb__diy_fp_mul(Cerdeb_Diy_Fp a, Cerdeb_Diy_Fp b) {
+    Cerdeb_Diy_Fp r;
+#if defined(__SIZEOF_INT128__)
+    __uint128_t p = (__uint128_t)a.f * b.f;
+    r.f = (uint64_t)(p >> 64) + ((uint64_t)p >> 63);
+#else
+    const uint64_t m32 = 0xFFFFFFFF;
+    uint64_t ah = a.f >> 32, al = a.f & m32, bh = b.f >> 32, bl = b.f & m32;
+    uint64_t hh = ah*bh, lh = al*bh, hl = ah*bl, ll = al*bl;
+    uint64_t mid = (ll >> 32) + (hl & m32) + (lh & m32) + (1u << 31);
+    r.f = hh + (hl >> 32) + (lh >> 32) + (mid >> 32);
+#endif
+    r.e = a.e + b.e + 64;
+    return r;
+}
+
+static inline Cerdeb_Diy_Fp cerdeb__diy_fp_normalize(Cerdeb_Diy_Fp v) {
+    while (!(v.f & (1ull << 63))) {
+        v.f <<= 1;
+        v.e--;
+    }
+    return v;
+}
+
+static inline void cerdeb__grisu_round(char* buf, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static inline int cerdeb__grisu_digits(Cerdeb_Diy_Fp w, Cerdeb_Diy_Fp mp, uint64_t delta, char* buf, int* k) {
+    Cerdeb_Diy_Fp one = { 1ull << -mp.e, mp.e };
+    uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = (int)cerdeb_u64_len(p1);
+    int len = 0;
+
+    while (kappa > 0) {
+        uint32_t pow = (uint32_t)cerdeb__pow10[kappa - 1];
+        uint32_t d = p1 / pow;
+        p1 %= pow;
+        if (d || len) buf[len++] = (char)('0' + d);
+        kappa--;
+
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest <= delta) {
+            *k += kappa;
+            cerdeb__grisu_round(buf, len, delta, rest, cerdeb__pow10[kappa] << -one.e, wp_w);
+            return len;
+        }
+    }
+
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> -one.e);
+        if (d || len) buf[len++] = (char)('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+
+        if (p2 < delta) {
+            *k += kappa;
+            int index = -kappa;
+            cerdeb__grisu_round(buf, len, delta, p2, one.f, wp_w * (index < 20 ? cerdeb__pow10[index] : 0));
+            return len;
+        }
+    }
+}
+
+// `f` and `e` describe a positive value f * 2^e whose significand has
+// `precision` bits (hidden bit included), `buf` receives the digits and `k`
+// their decimal exponent
+static inline int cerdeb__grisu2(uint64_t f, int e, int precision, char* buf, int* k) {
+    uint64_t hidden = 1ull << (precision - 1);
+
+    Cerdeb_Diy_Fp pl = { (f << 1) + 1, e - 1 };
+    pl = cerdeb__diy_fp_normalize(pl);
+
+    Cerdeb_Diy_Fp mi;
+    if (f == hidden) {
+        mi.f = (f << 2) - 1;
+        mi.e = e - 2;
+    } else {
+        mi.f = (f << 1) - 1;
+        mi.e = e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+
+    // cached power c_mk such that the scaled upper boundary has its exponent in [-60, -32]
+    double dk = (-61 - pl.e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+    if (dk - ik > 0.0) ik++;
+    unsigned index = (unsigned)((ik >> 3) + 1);
+    *k = -(-348 + (int)(index << 3));
+    Cerdeb_Diy_Fp c_mk = { cerdeb__cached_powers_f[index], cerdeb__cached_powers_e[index] };
+
+    Cerdeb_Diy_Fp v = { f, e };
+    Cerdeb_Diy_Fp w = cerdeb__diy_fp_mul(cerdeb__diy_fp_normalize(v), c_mk);
+    Cerdeb_Diy_Fp wp = cerdeb__diy_fp_mul(pl, c_mk);
+    Cerdeb_Diy_Fp wm = cerdeb__diy_fp_mul(mi, c_mk);
+    wm.f++;
+    wp.f--;
+    return cerdeb__grisu_digits(w, wp, wp.f - wm.f, buf, k);
+}
+
+static inline char* cerdeb__write_exponent(char* p, int k) {
+    if (k < 0) {
+        *p++ = '-';
+        k = -k;
+    }
+    return cerdeb_write_u64(p, (uint64_t)k);
+}
+
+// Lays out `len` digits with decimal exponent `k` that are already at `p`
+static inline char* cerdeb__prettify(char* p, int len, int k) {
+    int kk = len + k; // 10^(kk-1) <= v < 10^kk
+
+    if (0 <= k && kk <= 21) {
+        // 1234e7 -> 12340000000.0
+        for (int i = len; i < kk; ++i) p[i] = '0';
+        p[kk] = '.';
+        p[kk + 1] = '0';
+        return p + kk + 2;
+    }
+
+    if (0 < kk && kk <= 21) {
+        // 1234e-2 -> 12.34
+        memmove(p + kk + 1, p + kk, (size_t)(len - kk));
+        p[kk] = '.';
+        return p + len + 1;
+    }
+
+    if (-6 < kk && kk <= 0) {
+        // 1234e-6 -> 0.001234
+        int offset = 2 - kk;
+        memmove(p + offset, p, (size_t)len);
+        p[0] = '0';
+        p[1] = '.';
+        for (int i = 2; i < offset; ++i) p[i] = '0';
+        return p + len + offset;
+    }
+
+    if (len == 1) {
+        // 1e30
+        p[1] = 'e';
+        return cerdeb__write_exponent(p + 2, kk - 1);
+    }
+
+    // 1234e30 -> 1.234e33
+    memmove(p + 2, p + 1, (size_t)(len - 1));
+    p[1] = '.';
+    p[len + 1] = 'e';
+    return cerdeb__write_exponent(p + len + 2, kk - 1);
+}
+
+static inline char* cerdeb__write_float(char* p, uint64_t bits, int precision, int exponent_bits) {
+    uint64_t sig_mask = (1ull << (precision - 1)) - 1;
+    uint64_t exp_mask = (1ull << exponent_bits) - 1;
+    int bias = (int)(exp_mask >> 1) + precision - 1;
+
+    uint64_t sig = bits & sig_mask;
+    uint64_t biased = (bits >> (precision - 1)) & exp_mask;
+    bool negative = (bits >> (precision - 1 + exponent_bits)) & 1;
+
+    if (biased == exp_mask) {
+        if (sig != 0) return cerdeb_write_lit(p, "nan", 3);
+        if (negative) *p++ = '-';
+        return cerdeb_write_lit(p, "inf", 3);
+    }
+
+    if (negative) *p++ = '-';
+    if (biased == 0 && sig == 0) return cerdeb_write_lit(p, "0.0", 3);
+
+    uint64_t f = sig;
+    int e = 1 - bias;
+    if (biased != 0) {
+        f += sig_mask + 1;
+        e = (int)biased - bias;
+    }
+
+    int k;
+    int len = cerdeb__grisu2(f, e, precision, p, &k);
+    return cerdeb__prettify(p, len, k);
+}
+
+static inline char* cerdeb_write_f64(char* p, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return cerdeb__write_float(p, bits, 53, 11);
+}
+
+static inline char* cerdeb_write_f32(char* p, float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return cerdeb__write_float(p, bits, 24, 8);
+}
+
+// Columnar integer formatting used by the batch printers.
+//
+// The batch printers format each integer field of a block of records at
+// once: the values are converted to text 16 digits at a time with SIMD
+// (SSE2, or AVX2 when the CPU has it, two values at a time) and the rows are
+// then assembled by copying from the column. Other platforms fall back to
+// the scalar routines above.
+
+#define CERDEB_COLUMN_LEN 64
+
+// slot layout: [sign][4 digits above 10^16][16 low digits]
+#define CERDEB__SLOT_DIGITS 5
+#define CERDEB__SLOT_END 21
+
+typedef struct {
+    char slots[CERDEB_COLUMN_LEN][24];
+    uint8_t start[CERDEB_COLUMN_LEN];
+} Cerdeb_Column;
+
+static inline char* cerdeb_write_column(char* p, const Cerdeb_Column* col, size_t i) {
+    size_t start = col->start[i];
+    return cerdeb_write_lit(p, col->slots[i] + start, CERDEB__SLOT_END - start);
+}
+
+// Puts what doesn't fit in the 16 low digits and the sign in front of them
+static inline void cerdeb__column_finish(Cerdeb_Column* col, size_t i, int64_t v, uint64_t u, size_t zeros) {
+    char* slot = col->slots[i];
+    size_t start = CERDEB__SLOT_DIGITS + zeros;
+
+    if (u >= cerdeb__pow10[16]) {
+        uint64_t high = u / cerdeb__pow10[16];
+        start = CERDEB__SLOT_DIGITS - cerdeb_u64_len(high);
+        cerdeb_write_u64(slot + start, high);
+    }
+
+    if (v < 0) slot[--start] = '-';
+    col->start[i] = (uint8_t)start;
+}
+
+static inline uint64_t cerdeb__abs(int64_t v) {
+    return v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+}
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <immintrin.h>
+
+// 8 decimal digits of v < 10^8 in the 16-bit lanes, see
+// http://0x80.pl/articles/sse-itoa.html
+static inline __m128i cerdeb__digits8_sse2(uint32_t v) {
+    const __m128i div_powers = _mm_setr_epi16(8389, 5243, 13108, (short)32768, 8389, 5243, 13108, (short)32768);
+    const __m128i shift_powers = _mm_setr_epi16(1 << 7, 1 << 11, 1 << 13, (short)(1 << 15), 1 << 7, 1 << 11, 1 << 13, (short)(1 << 15));
+
+    __m128i x = _mm_cvtsi32_si128((int)v);
+    __m128i abcd = _mm_srli_epi64(_mm_mul_epu32(x, _mm_set1_epi32((int)0xd1b71759)), 45);
+    __m128i efgh = _mm_sub_epi32(x, _mm_mul_epu32(abcd, _mm_set1_epi32(10000)));
+    __m128i v1 = _mm_slli_epi64(_mm_unpacklo_epi16(abcd, efgh), 2);
+    __m128i v2 = _mm_unpacklo_epi32(_mm_unpacklo_epi16(v1, v1), _mm_unpacklo_epi16(v1, v1));
+    __m128i v4 = _mm_mulhi_epu16(_mm_mulhi_epu16(v2, div_powers), shift_powers);
+    __m128i v6 = _mm_slli_epi64(_mm_mullo_epi16(v4, _mm_set1_epi16(10)), 16);
+    return _mm_sub_epi16(v4, v6);
+}
+
+static inline void cerdeb__format_column_sse2(Cerdeb_Column* col, const int64_t* values, size_t i, size_t n) {
+    for (; i < n; ++i) {
+        uint64_t u = cerdeb__abs(values[i]);
+        uint64_t low = u % cerdeb__pow10[16];
+
+        __m128i hi = cerdeb__digits8_sse2((uint32_t)(low / 100000000));
+        __m128i lo = cerdeb__digits8_sse2((uint32_t)(low % 100000000));
+        __m128i digits = _mm_add_epi8(_mm_packus_epi16(hi, lo), _mm_set1_epi8('0'));
+        _mm_storeu_si128((__m128i*)(col->slots[i] + CERDEB__SLOT_DIGITS), digits);
+
+        // keep at least the last digit
+        unsigned zeros = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(digits, _mm_set1_epi8('0')));
+        cerdeb__column_finish(col, i, values[i], u, __builtin_ctz(~zeros | 0x8000));
+    }
+}
+
+// Same as cerdeb__digits8_sse2 for two values, one per 128-bit lane
+__attribute__((target("avx2")))
+static inline __m256i cerdeb__digits8_avx2(uint32_t a, uint32_t b) {
+    const __m256i div_powers = _mm256_setr_epi16(
+        8389, 5243, 13108, (short)32768, 8389, 5243, 13108, (short)32768,
+        8389, 5243, 13108, (short)32768, 8389, 5243, 13108, (short)32768);
+    const __m256i shift_powers = _mm256_setr_epi16(
+        1 << 7, 1 << 11, 1 << 13, (short)(1 << 15), 1 << 7, 1 << 11, 1 << 13, (short)(1 << 15),
+        1 << 7, 1 << 11, 1 << 13, (short)(1 << 15), 1 << 7, 1 << 11, 1 << 13, (short)(1 << 15));
+
+    __m256i x = _mm256_setr_epi32((int)a, 0, 0, 0, (int)b, 0, 0, 0);
+    __m256i abcd = _mm256_srli_epi64(_mm256_mul_epu32(x, _mm256_set1_epi32((int)0xd1b71759)), 45);
+    __m256i efgh = _mm256_sub_epi32(x, _mm256_mul_epu32(abcd, _mm256_set1_epi32(10000)));
+    __m256i v1 = _mm256_slli_epi64(_mm256_unpacklo_epi16(abcd, efgh), 2);
+    __m256i v2 = _mm256_unpacklo_epi32(_mm256_unpacklo_epi16(v1, v1), _mm256_unpacklo_epi16(v1, v1));
+    __m256i v4 = _mm256_mulhi_epu16(_mm256_mulhi_epu16(v2, div_powers), shift_powers);
+    __m256i v6 = _mm256_slli_epi64(_mm256_mullo_epi16(v4, _mm256_set1_epi16(10)), 16);
+    return _mm256_sub_epi16(v4, v6);
+}
+
+__attribute__((target("avx2")))
+static inline void cerdeb__format_column_avx2(Cerdeb_Column* col, const int64_t* values, size_t n) {
+    size_t i = 0;
+    for (; i + 1 < n; i += 2) {
+        uint64_t ua = cerdeb__abs(values[i]);
+        uint64_t ub = cerdeb__abs(values[i + 1]);
+        uint64_t la = ua % cerdeb__pow10[16];
+        uint64_t lb = ub % cerdeb__pow10[16];
+
+        __m256i hi = cerdeb__digits8_avx2((uint32_t)(la / 100000000), (uint32_t)(lb / 100000000));
+        __m256i lo = cerdeb__digits8_avx2((uint32_t)(la % 100000000), (uint32_t)(lb % 100000000));
+        __m256i digits = _mm256_add_epi8(_mm256_packus_epi16(hi, lo), _mm256_set1_epi8('0'));
+        _mm_storeu_si128((__m128i*)(col->slots[i] + CERDEB__SLOT_DIGITS), _mm256_castsi256_si128(digits));
+        _mm_storeu_si128((__m128i*)(col->slots[i + 1] + CERDEB__SLOT_DIGITS), _mm256_extracti128_si256(digits, 1));
+
+        unsigned zeros = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(digits, _mm256_set1_epi8('0')));
+        cerdeb__column_finish(col, i, values[i], ua, __builtin_ctz(~zeros | 0x8000));
+        cerdeb__column_finish(col, i + 1, values[i + 1], ub, __builtin_ctz((~zeros >> 16) | 0x8000));
+    }
+    cerdeb__format_column_sse2(col, values, i, n);
+}
+
+static inline void cerdeb_format_column(Cerdeb_Column* col, const int64_t* values, size_t n) {
+    if (__builtin_cpu_supports("avx2")) {
+        cerdeb__format_column_avx2(col, values, n);
+    } else {
+        cerdeb__format_column_sse2(col, values, 0, n);
+    }
+}
+#else
+static inline void cerdeb_format_column(Cerdeb_Column* col, const int64_t* values, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        char* end = cerdeb_write_i64(col->slots[i], values[i]);
+        size_t len = end - col->slots[i];
+        memmove(col->slots[i] + CERDEB__SLOT_END - len, col->slots[i], len);
+        col->start[i] = (uint8_t)(CERDEB__SLOT_END - len);
+    }
+}
+#endif
+
+// Fixed-size array fields.
+//
+// Arrays are printed as [a, b, c] with at most CERDEB_ARRAY_CAP elements, the
+// longer ones end with ", ...", so the time and the room taken by a record
+// stay bounded whatever the size of its arrays. Integer elements go through
+// the column kernel. char[N] fields are printed like strings, up to their
+// first 0 or their N-th character.
+
+#ifndef CERDEB_ARRAY_CAP
+#define CERDEB_ARRAY_CAP 16
+#endif
+
+#define CERDEB_ARRAY_SHOWN(n) ((size_t)(n) < CERDEB_ARRAY_CAP ? (size_t)(n) : CERDEB_ARRAY_CAP)
+// "[", the elements and their ", ", then ", ...]" at most
+#define CERDEB_ARRAY_MAX_LEN(n, elem_max_len) (2 + CERDEB_ARRAY_SHOWN(n) * ((elem_max_len) + 2) + 3)
+
+static inline int64_t cerdeb__load_int(const char* p, size_t size) {
+    switch (size) {
+        case 1: { int8_t v; memcpy(&v, p, 1); return v; }
+        case 2: { int16_t v; memcpy(&v, p, 2); return v; }
+        case 4: { int32_t v; memcpy(&v, p, 4); return v; }
+        default: { int64_t v; memcpy(&v, p, 8); return v; }
+    }
+}
+
+// the first `n` elements of `arr`, each `size` bytes, separated by ", "
+static inline char* cerdeb_write_int_array(char* p, const void* arr, size_t size, size_t n) {
+    const char* a = (const char*)arr;
+    Cerdeb_Column col;
+    int64_t values[CERDEB_COLUMN_LEN];
+
+    for (size_t base = 0; base < n; base += CERDEB_COLUMN_LEN) {
+        size_t m = n - base < CERDEB_COLUMN_LEN ? n - base : CERDEB_COLUMN_LEN;
+        for (size_t i = 0; i < m; ++i) values[i] = cerdeb__load_int(a + (base + i) * size, size);
+        cerdeb_format_column(&col, values, m);
+        for (size_t i = 0; i < m; ++i) {
+            if (base + i != 0) p = cerdeb_write_lit(p, ", ", 2);
+            p = cerdeb_write_column(p, &col, i);
+        }
+    }
+
+    return p;
+}
+
+static inline char* cerdeb_write_array_end(char* p, size_t n) {
+    if (n > CERDEB_ARRAY_CAP) p = CERDEB_ARRAY_CAP > 0 ? cerdeb_write_lit(p, ", ...", 5) : cerdeb_write_lit(p, "...", 3);
+    *p++ = ']';
+    return p;
+}
+
+static inline size_t cerdeb_chars_len(const char* s, size_t n) {
+    const char* end = (const char*)memchr(s, '\0', n);
+    return end ? (size_t)(end - s) : n;
+}
+
+static inline char* cerdeb_write_chars(char* p, const char* s, size_t n) {
+    return cerdeb_write_lit(p, s, cerdeb_chars_len(s, n));
+}
+
+// Pointer following.
+//
+// The pointers to derived structs of a struct derived with `!follow` are
+// printed as &Name { ... } instead of their address. Every pointer field of
+// the printed record starts a walk of at most CERDEB_FOLLOW_DEPTH levels and
+// CERDEB_FOLLOW_NODES structs, the pointers past the budget are printed as
+// addresses and the ones already printed by the walk as "0x... (seen)", so a
+// cyclic graph is printed in bounded time and room.
+//
+// The walk lives in a thread-local open-addressing set, which the generated
+// _debug_max_len and _debug_write go through in the same order, so both see
+// the same structs. The signal-safe printers only print the addresses.
+
+#ifndef CERDEB_FOLLOW_DEPTH
+#define CERDEB_FOLLOW_DEPTH 8
+#endif
+
+#ifndef CERDEB_FOLLOW_NODES
+#define CERDEB_FOLLOW_NODES 64
+#endif
+
+// the nodes and the record the walk starts from, at most half full
+#define CERDEB__FOLLOW_SET (2 * (CERDEB_FOLLOW_NODES + 1))
+
+// "0x... (seen)" is the longest, "&" comes before the followed struct
+#define CERDEB_FOLLOW_MAX_LEN (CERDEB_PTR_MAX_LEN + 7)
+
+typedef enum {
+    CERDEB_FOLLOW_NULL,
+    CERDEB_FOLLOW_SEEN,
+    CERDEB_FOLLOW_STOP, // out of depth or nodes
+    CERDEB_FOLLOW_GO,
+} Cerdeb_Follow_Step;
+
+typedef struct {
+    const void* seen[CERDEB__FOLLOW_SET];
+    size_t used[CERDEB__FOLLOW_SET]; // taken slots, cleared by the next walk
+    size_t count;
+    size_t nodes;
+    size_t depth;
+} Cerdeb_Follow;
+
+extern CERDEB_THREAD_LOCAL Cerdeb_Follow cerdeb__follow;
+
+static inline size_t cerdeb__follow_slot(const Cerdeb_Follow* f, const void* ptr) {
+    size_t i = (size_t)(((uintptr_t)ptr >> 3) * 0x9E3779B97F4A7C15ull % CERDEB__FOLLOW_SET);
+    while (f->seen[i] != NULL && f->seen[i] != ptr) {
+        i = i + 1 == CERDEB__FOLLOW_SET ? 0 : i + 1;
+    }
+    return i;
+}
+
+static inline void cerdeb__follow_insert(Cerdeb_Follow* f, size_t i, const void* ptr) {
+    f->seen[i] = ptr;
+    f->used[f->count++] = i;
+}
+
+// `owner` is the struct holding the pointer, it is part of a new walk
+static inline Cerdeb_Follow_Step cerdeb_follow_enter(const void* owner, const void* ptr) {
+    Cerdeb_Follow* f = &cerdeb__follow;
+    if (ptr == NULL) return CERDEB_FOLLOW_NULL;
+
+    if (f->depth == 0) {
+        for (size_t i = 0; i < f->count; ++i) f->seen[f->used[i]] = NULL;
+        f->count = 0;
+        f->nodes = 0;
+        cerdeb__follow_insert(f, cerdeb__follow_slot(f, owner), owner);
+    }
+
+    size_t i = cerdeb__follow_slot(f, ptr);
+    if (f->seen[i] == ptr) return CERDEB_FOLLOW_SEEN;
+    if (f->depth >= CERDEB_FOLLOW_DEPTH || f->nodes >= CERDEB_FOLLOW_NODES) return CERDEB_FOLLOW_STOP;
+
+    cerdeb__follow_insert(f, i, ptr);
+    f->nodes += 1;
+    f->depth += 1;
+    return CERDEB_FOLLOW_GO;
+}
+
+static inline void cerdeb_follow_leave(void) {
+    cerdeb__follow.depth -= 1;
+}
+
+// what comes before the followed struct, or in place of it
+static inline char* cerdeb_write_follow(char* p, const void* ptr, Cerdeb_Follow_Step step) {
+    switch (step) {
+        case CERDEB_FOLLOW_GO: *p++ = '&'; return p;
+        case CERDEB_FOLLOW_SEEN: return cerdeb_write_lit(cerdeb_write_ptr(p, ptr), " (seen)", 7);
+        default: return cerdeb_write_ptr(p, ptr);
+    }
+}
+
+// Struct diffs.
+//
+// Name_debug_equal(a, b) compares two structs the way they are printed and
+// Name_debug_diff(a, b) prints only the fields that differ, as
+// Name { .x = 1 -> 2 }, with the nested structs printing their own diff. The
+// runs of fixed-size fields are compared with a single memcmp over their
+// span first, so the identical parts of a large struct cost one call.
+// Arrays are compared whole though, and the ones that only differ past the
+// first CERDEB_ARRAY_CAP elements are printed as [...] -> [...].
+
+// the bytes from the field `first` to the end of the field `last`
+#define CERDEB_SPAN(Type, first, last) (offsetof(Type, last) + sizeof(((Type*)0)->last) - offsetof(Type, first))
+
+static inline bool cerdeb_str_equal(const char* a, const char* b) {
+    if (a == NULL || b == NULL) return a == b;
+    return strcmp(a, b) == 0;
+}
+
+static inline bool cerdeb_strn_equal(const char* a, size_t a_len, const char* b, size_t b_len) {
+    if (a == NULL || b == NULL) return a == b;
+    return a_len == b_len && memcmp(a, b, a_len) == 0;
+}
+
+// the first field that differs comes right after the "{" at `start`
+static inline char* cerdeb_write_diff_field(char* p, const char* start, const char* lit, size_t len) {
+    if (p != start) *p++ = ',';
+    return cerdeb_write_lit(p, lit, len);
+}
+
+// Enums.
+//
+// A derived enum gets Name_debug_name(value), the name of a value or NULL, and
+// the fields of its type print that name. The names are looked up in a table
+// indexed by the value when the values are dense enough, and by a switch
+// otherwise. The values without a name are printed as (Name)42.
+
+// the name of an enum value and its length, {0} if it has none
+typedef struct {
+    const char* text;
+    size_t len;
+} Cerdeb_Name;
+
+#define CERDEB_NAME(s) { s, sizeof(s) - 1 }
+
+static inline char* cerdeb_write_enum(char* p, Cerdeb_Name name, const char* cast, size_t cast_len, int64_t value) {
+    if (name.text) return cerdeb_write_lit(p, name.text, name.len);
+    p = cerdeb_write_lit(p, cast, cast_len);
+    return cerdeb_write_i64(p, value);
+}
+
+// Multicore batch printing.
+//
+// cerdeb_parallel_print splits an array in rounds of `threads` chunks of
+// CERDEB_PARALLEL_CHUNK records, every chunk is formatted by its own worker
+// into its own buffer and each round is written with a single writev, so the
+// output is byte-identical to the serial batch printer. The generated
+// Name_debug_fd_print_many functions are thin wrappers around it.
+
+#ifndef _WIN32
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 16 // _XOPEN_IOV_MAX
+#endif
+
+#ifndef CERDEB_PARALLEL_CHUNK
+#define CERDEB_PARALLEL_CHUNK (1 << 16)
+#endif
+
+typedef size_t (*Cerdeb_Max_Len_Many)(const void* arr, size_t n);
+typedef char* (*Cerdeb_Write_Many)(char* p, const void* arr, size_t n);
+
+typedef struct {
+    const char* arr;
+    size_t n;
+    Cerdeb_Max_Len_Many max_len_many;
+    Cerdeb_Write_Many write_many;
+    char* buf;
+    size_t capacity;
+    size_t len;
+    bool ok;
+} Cerdeb__Chunk;
+
+static inline void* cerdeb__format_chunk(void* arg) {
+    Cerdeb__Chunk* chunk = (Cerdeb__Chunk*)arg;
+    size_t len = chunk->max_len_many(chunk->arr, chunk->n);
+
+    if (len > chunk->capacity) {
+        free(chunk->buf);
+        chunk->buf = (char*)malloc(len);
+        chunk->capacity = chunk->buf ? len : 0;
+    }
+
+    chunk->ok = chunk->buf != NULL;
+    if (chunk->ok) chunk->len = chunk->write_many(chunk->buf, chunk->arr, chunk->n) - chunk->buf;
+    return NULL;
+}
+
+static inline bool cerdeb__writev_all(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+// `threads` == 0 uses every online CPU
+static inline bool cerdeb_parallel_print(int fd, const void* arr, size_t n, size_t size, size_t threads,
+                                         Cerdeb_Max_Len_Many max_len_many, Cerdeb_Write_Many write_many) {
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (size_t)cpus : 1;
+    }
+
+    size_t needed = (n + CERDEB_PARALLEL_CHUNK - 1) / CERDEB_PARALLEL_CHUNK;
+    if (threads > needed) threads = needed;
+    if (threads > IOV_MAX) threads = IOV_MAX;
+    if (threads == 0) return true;
+
+    Cerdeb__Chunk* chunks = (Cerdeb__Chunk*)calloc(threads, sizeof(*chunks));
+    pthread_t* workers = (pthread_t*)calloc(threads, sizeof(*workers));
+    struct iovec* iov = (struct iovec*)calloc(threads, sizeof(*iov));
+    bool ok = chunks && workers && iov;
+
+    for (size_t base = 0; ok && base < n; ) {
+        size_t count = 0;
+        for (; count < threads && base < n; ++count) {
+            Cerdeb__Chunk* chunk = &chunks[count];
+            chunk->arr = (const char*)arr + base * size;
+            chunk->n = n - base < CERDEB_PARALLEL_CHUNK ? n - base : CERDEB_PARALLEL_CHUNK;
+            chunk->max_len_many = max_len_many;
+            chunk->write_many = write_many;
+            base += chunk->n;
+        }
+
+        // the calling thread formats the first chunk itself
+        size_t spawned = 1;
+        for (; spawned < count; ++spawned) {
+            if (pthread_create(&workers[spawned], NULL, cerdeb__format_chunk, &chunks[spawned]) != 0) break;
+        }
+        for (size_t i = spawned; i < count; ++i) cerdeb__format_chunk(&chunks[i]);
+        cerdeb__format_chunk(&chunks[0]);
+        for (size_t i = 1; i < spawned; ++i) pthread_join(workers[i], NULL);
+
+        for (size_t i = 0; i < count; ++i) {
+            ok = ok && chunks[i].ok;
+            iov[i].iov_base = chunks[i].buf;
+            iov[i].iov_len = chunks[i].len;
+        }
+        ok = ok && cerdeb__writev_all(fd, iov, (int)count);
+    }
+
+    if (chunks) {
+        for (size_t i = 0; i < threads; ++i) free(chunks[i].buf);
+    }
+    free(chunks);
+    free(workers);
+    free(iov);
+    return ok;
+}
+#endif // _WIN32
+
+// Async-signal-safe output for the Name_debug_write_signal_safe printers:
+// no locks, no allocation, only write(2). Strings are printed up to
+// CERDEB_SIGNAL_SAFE_STR_MAX bytes so the time spent in the handler stays
+// bounded even if the string is corrupted.
+//
+// The rest of the record goes through a stack buffer of
+// CERDEB_SIGNAL_SAFE_BUF bytes, whatever the size of the struct, since the
+// handler may run on a small sigaltstack. It is flushed whenever the next
+// number or enum name might not fit, and the strings and char arrays are
+// written straight from the struct. It has to hold the longest enum name.
+
+#ifndef _WIN32
+#ifndef CERDEB_SIGNAL_SAFE_STR_MAX
+#define CERDEB_SIGNAL_SAFE_STR_MAX 4096
+#endif
+
+#ifndef CERDEB_SIGNAL_SAFE_BUF
+#define CERDEB_SIGNAL_SAFE_BUF 256
+#endif
+
+// writes [buf, p) to `fd` and returns `buf`, errors are ignored
+static inline char* cerdeb_flush_fd(int fd, char* buf, char* p) {
+    const char* data = buf;
+    while (data < p) {
+        ssize_t written = write(fd, data, p - data);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) break;
+        data += written;
+    }
+    return buf;
+}
+
+// flushes `buf` unless `n` more bytes fit after `p`
+static inline char* cerdeb_room_fd(int fd, char* buf, char* p, size_t n) {
+    if ((size_t)(buf + CERDEB_SIGNAL_SAFE_BUF - p) >= n) return p;
+    return cerdeb_flush_fd(fd, buf, p);
+}
+
+static inline char* cerdeb_write_lit_fd(int fd, char* buf, char* p, const char* s, size_t n) {
+    if (n > CERDEB_SIGNAL_SAFE_BUF) {
+        p = cerdeb_flush_fd(fd, buf, p);
+        cerdeb_flush_fd(fd, (char*)s, (char*)s + n);
+        return p;
+    }
+    return cerdeb_write_lit(cerdeb_room_fd(fd, buf, p, n), s, n);
+}
+
+static inline void cerdeb_write_str_fd(int fd, const char* s) {
+    if (s == NULL) s = "(null)";
+
+    size_t len = 0;
+    while (len < CERDEB_SIGNAL_SAFE_STR_MAX && s[len] != '\0') ++len;
+    cerdeb_flush_fd(fd, (char*)s, (char*)s + len);
+}
+
+static inline void cerdeb_write_strn_fd(int fd, const char* s, size_t n) {
+    if (s == NULL) cerdeb_write_str_fd(fd, s);
+    else cerdeb_flush_fd(fd, (char*)s, (char*)s + (n < CERDEB_SIGNAL_SAFE_STR_MAX ? n : CERDEB_SIGNAL_SAFE_STR_MAX));
+}
+#endif // _WIN32
+
+// Log levels.
+//
+// CERDEB_ERROR(Name, ptr) ... CERDEB_TRACE(Name, ptr) print the struct at
+// `ptr`, prefixed by the level, through cerdeb_sink (stderr by default).
+//
+// A macro above the compile-time CERDEB_LEVEL expands to nothing. The others
+// compare their level with the runtime cerdeb_level first, so a disabled
+// record costs one branch, and neither `ptr` is evaluated nor anything is
+// formatted. With -DCERDEB_LEVEL=CERDEB_LEVEL_OFF the generated text
+// printers are not compiled at all, only the binary logging of `!log` is
+// left.
+//
+// Name_debug_lazy(ptr) captures the printer and the pointer in a
+// Cerdeb_Lazy handle that is only formatted if cerdeb_emit_lazy accepts its
+// level.
+
+#define CERDEB_LEVEL_OFF 0
+#define CERDEB_LEVEL_ERROR 1
+#define CERDEB_LEVEL_WARN 2
+#define CERDEB_LEVEL_INFO 3
+#define CERDEB_LEVEL_DEBUG 4
+#define CERDEB_LEVEL_TRACE 5
+
+#ifndef CERDEB_LEVEL
+#define CERDEB_LEVEL CERDEB_LEVEL_TRACE
+#endif
+
+#define CERDEB_PRINTERS (CERDEB_LEVEL > CERDEB_LEVEL_OFF)
+
+// `text` is the prefixed record followed by a new line
+typedef void (*Cerdeb_Sink)(int level, const char* text, size_t len);
+
+extern int cerdeb_level; // starts at CERDEB_LEVEL
+extern Cerdeb_Sink cerdeb_sink;
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CERDEB_ENABLED(level) __builtin_expect((level) <= cerdeb_level, 0)
+#else
+#define CERDEB_ENABLED(level) ((level) <= cerdeb_level)
+#endif
+
+#define CERDEB__LOG(level, Name, ptr) (CERDEB_ENABLED(level) ? Name##_debug_emit((level), (ptr)) : (void)0)
+
+// sizeof keeps `ptr` referenced without evaluating it
+#define CERDEB__STRIPPED(ptr) ((void)sizeof(ptr))
+
+#if CERDEB_LEVEL >= CERDEB_LEVEL_ERROR
+#define CERDEB_ERROR(Name, ptr) CERDEB__LOG(CERDEB_LEVEL_ERROR, Name, ptr)
+#else
+#define CERDEB_ERROR(Name, ptr) CERDEB__STRIPPED(ptr)
+#endif
+
+#if CERDEB_LEVEL >= CERDEB_LEVEL_WARN
+#define CERDEB_WARN(Name, ptr) CERDEB__LOG(CERDEB_LEVEL_WARN, Name, ptr)
+#else
+#define CERDEB_WARN(Name, ptr) CERDEB__STRIPPED(ptr)
+#endif
+
+#if CERDEB_LEVEL >= CERDEB_LEVEL_INFO
+#define CERDEB_INFO(Name, ptr) CERDEB__LOG(CERDEB_LEVEL_INFO, Name, ptr)
+#else
+#define CERDEB_INFO(Name, ptr) CERDEB__STRIPPED(ptr)
+#endif
+
+#if CERDEB_LEVEL >= CERDEB_LEVEL_DEBUG
+#define CERDEB_DEBUG(Name, ptr) CERDEB__LOG(CERDEB_LEVEL_DEBUG, Name, ptr)
+#else
+#define CERDEB_DEBUG(Name, ptr) CERDEB__STRIPPED(ptr)
+#endif
+
+#if CERDEB_LEVEL >= CERDEB_LEVEL_TRACE
+#define CERDEB_TRACE(Name, ptr) CERDEB__LOG(CERDEB_LEVEL_TRACE, Name, ptr)
+#else
+#define CERDEB_TRACE(Name, ptr) CERDEB__STRIPPED(ptr)
+#endif
+
+#if CERDEB_PRINTERS
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CERDEB_EMIT_STACK 512
+
+typedef size_t (*Cerdeb_Max_Len)(const void* ptr);
+typedef char* (*Cerdeb_Write)(char* p, const void* ptr);
+
+typedef struct {
+    const void* ptr;
+    Cerdeb_Max_Len max_len;
+    Cerdeb_Write write;
+} Cerdeb_Lazy;
+
+static const char* const cerdeb__level_names[] = {
+    "OFF ", "ERROR ", "WARN ", "INFO ", "DEBUG ", "TRACE "
+};
+
+// formats `lazy` without looking at the level, records that don't fit on the
+// stack are formatted in heap memory
+static inline void cerdeb__emit(int level, Cerdeb_Lazy lazy) {
+    char stack[CERDEB_EMIT_STACK];
+    const char* name = cerdeb__level_names[level];
+    size_t name_len = strlen(name);
+    size_t len = name_len + lazy.max_len(lazy.ptr) + 1;
+
+    char* buf = len <= sizeof(stack) ? stack : (char*)malloc(len);
+    if (buf == NULL) return;
+
+    char* p = cerdeb_write_lit(buf, name, name_len);
+    p = lazy.write(p, lazy.ptr);
+    *p++ = '\n';
+    cerdeb_sink(level, buf, p - buf);
+    if (buf != stack) free(buf);
+}
+
+static inline void cerdeb_emit_lazy(int level, Cerdeb_Lazy lazy) {
+    if (CERDEB_ENABLED(level)) cerdeb__emit(level, lazy);
+}
+
+// the text was formatted already
+static inline void cerdeb__emit_text(int level, const char* text, size_t text_len) {
+    char stack[CERDEB_EMIT_STACK];
+    const char* name = cerdeb__level_names[level];
+    size_t name_len = strlen(name);
+    size_t len = name_len + text_len + 1;
+
+    char* buf = len <= sizeof(stack) ? stack : (char*)malloc(len);
+    if (buf == NULL) return;
+
+    char* p = cerdeb_write_lit(buf, name, name_len);
+    p = cerdeb_write_lit(p, text, text_len);
+    *p++ = '\n';
+    cerdeb_sink(level, buf, p - buf);
+    if (buf != stack) free(buf);
+}
+
+// Memoized printing.
+//
+// Name_debug_print_cached(ptr) of a struct derived with `!cache` hashes the
+// bytes of the struct and the characters of its strings, and formats it only
+// if the hash isn't one of the last CERDEB_CACHE_SLOTS the thread printed for
+// that type. The text stays valid until the next cached print of the type on
+// the thread. Its log macros go through the cache too. The structs nested in
+// a `!cache` one have to be derived with `!cache` as well.
+
+#ifndef CERDEB_CACHE_SLOTS
+#define CERDEB_CACHE_SLOTS 4
+#endif
+
+#define CERDEB_HASH_SEED 0xcbf29ce484222325ull
+
+typedef struct {
+    uint64_t hash;
+    char* text; // NULL until the slot is used
+    size_t len;
+    size_t cap;
+} Cerdeb_Cache_Slot;
+
+typedef struct {
+    Cerdeb_Cache_Slot slots[CERDEB_CACHE_SLOTS];
+    size_t next; // replaced by the next miss
+} Cerdeb_Cache;
+
+static inline uint64_t cerdeb__hash_mix(uint64_t h, uint64_t v) {
+    h = (h ^ v) * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 29);
+}
+
+// 32 bytes at a time in 4 independent lanes, then 8 bytes at a time, the
+// length goes into the last word
+static inline uint64_t cerdeb_hash(uint64_t h, const void* data, size_t n) {
+    const char* p = (const char*)data;
+    if (n >= 32) {
+        uint64_t a = h, b = h ^ 0x243F6A8885A308D3ull, c = h ^ 0x13198A2E03707344ull, d = h ^ 0xA4093822299F31D0ull;
+        for (; n >= 32; n -= 32, p += 32) {
+            uint64_t v[4];
+            memcpy(v, p, 32);
+            a = cerdeb__hash_mix(a, v[0]);
+            b = cerdeb__hash_mix(b, v[1]);
+            c = cerdeb__hash_mix(c, v[2]);
+            d = cerdeb__hash_mix(d, v[3]);
+        }
+        h = cerdeb__hash_mix(cerdeb__hash_mix(cerdeb__hash_mix(a, b), c), d);
+    }
+
+    for (; n >= 8; n -= 8, p += 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        h = cerdeb__hash_mix(h, v);
+    }
+
+    // a memcpy of a variable size would be a call
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; ++i) v |= (uint64_t)(unsigned char)p[i] << (8 * i);
+    return cerdeb__hash_mix(h, v ^ ((uint64_t)n << 56));
+}
+
+static inline uint64_t cerdeb_hash_strn(uint64_t h, const char* s, size_t n) {
+    if (s == NULL) return cerdeb__hash_mix(h, UINT64_MAX);
+    return cerdeb_hash(h, s, n);
+}
+
+static inline uint64_t cerdeb_hash_str(uint64_t h, const char* s) {
+    return cerdeb_hash_strn(h, s, s ? strlen(s) : 0);
+}
+
+static inline Cerdeb_Cache_Slot* cerdeb_cache_find(Cerdeb_Cache* cache, uint64_t hash) {
+    for (size_t i = 0; i < CERDEB_CACHE_SLOTS; ++i) {
+        Cerdeb_Cache_Slot* slot = &cache->slots[i];
+        if (slot->text && slot->hash == hash) return slot;
+    }
+    return NULL;
+}
+
+// a slot with room for `len` characters and a 0, NULL if out of memory
+static inline Cerdeb_Cache_Slot* cerdeb_cache_reserve(Cerdeb_Cache* cache, uint64_t hash, size_t len) {
+    Cerdeb_Cache_Slot* slot = &cache->slots[cache->next];
+    cache->next = (cache->next + 1) % CERDEB_CACHE_SLOTS;
+
+    if (slot->cap < len + 1) {
+        char* text = (char*)realloc(slot->text, len + 1);
+        if (text == NULL) {
+            free(slot->text);
+            *slot = (Cerdeb_Cache_Slot){0};
+            return NULL;
+        }
+        slot->text = text;
+        slot->cap = len + 1;
+    }
+
+    slot->hash = hash;
+    return slot;
+}
+#endif
+
+// one fwrite per record, so records of different threads don't interleave
+void cerdeb_sink_stderr(int level, const char* text, size_t len);
+
+// Sampled and rate-limited printing for hot paths.
+//
+// CERDEB_EVERY_N(level, n, Name, ptr) prints one out of every `n` calls of
+// each thread and CERDEB_RATE(level, per_second, Name, ptr) at most
+// `per_second` records per second, both counted per call site. They are
+// statements, the counters are statics of the call site. The runtime level is
+// checked first, then a thread-local countdown or a read of the coarse
+// monotonic clock (no syscall on Linux), so the skipped calls don't format
+// nor synchronize. Once a site has spent its quota it still reads the clock,
+// to see the next second, and its counter, but writes neither until then.
+
+#if CERDEB_PRINTERS
+static inline bool cerdeb_sample(uint32_t* skip, uint32_t n) {
+    if (*skip > 0) {
+        --*skip;
+        return false;
+    }
+    *skip = n > 0 ? n - 1 : 0;
+    return true;
+}
+
+#define CERDEB_EVERY_N(level, n, Name, ptr) do { \
+    static CERDEB_THREAD_LOCAL uint32_t cerdeb__skip = 0; \
+    if ((level) <= CERDEB_LEVEL && CERDEB_ENABLED(level) && cerdeb_sample(&cerdeb__skip, (n))) \
+        Name##_debug_emit((level), (ptr)); \
+} while (0)
+
+#ifndef _WIN32
+#include <stdatomic.h>
+#include <time.h>
+
+typedef struct {
+    _Atomic uint64_t second;
+    _Atomic uint32_t count;
+} Cerdeb_Rate;
+
+static inline uint64_t cerdeb__coarse_seconds(void) {
+    struct timespec now;
+#ifdef CLOCK_MONOTONIC_COARSE
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+    return (uint64_t)now.tv_sec;
+}
+
+// racing threads can let a few more records through when the second changes
+static inline bool cerdeb_rate_allow(Cerdeb_Rate* rate, uint32_t per_second) {
+    uint64_t now = cerdeb__coarse_seconds();
+    if (atomic_load_explicit(&rate->second, memory_order_relaxed) != now) {
+        atomic_store_explicit(&rate->second, now, memory_order_relaxed);
+        atomic_store_explicit(&rate->count, 0, memory_order_relaxed);
+    }
+
+    if (atomic_load_explicit(&rate->count, memory_order_relaxed) >= per_second) return false;
+    return atomic_fetch_add_explicit(&rate->count, 1, memory_order_relaxed) < per_second;
+}
+
+#define CERDEB_RATE(level, per_second, Name, ptr) do { \
+    static Cerdeb_Rate cerdeb__rate; \
+    if ((level) <= CERDEB_LEVEL && CERDEB_ENABLED(level) && cerdeb_rate_allow(&cerdeb__rate, (per_second))) \
+        Name##_debug_emit((level), (ptr)); \
+} while (0)
+#endif // _WIN32
+#else
+#define CERDEB_EVERY_N(level, n, Name, ptr) CERDEB__STRIPPED(ptr)
+#define CERDEB_RATE(level, per_second, Name, ptr) CERDEB__STRIPPED(ptr)
+#endif // CERDEB_PRINTERS
+
+// Binary logging of the structs derived with `!log`.
+//
+// Name_log packs the fields of a struct in a compact record tagged with the
+// static NAME_LOG_TYPE_ID and appends it to a per-thread buffer, the text is
+// only produced later by cerdeb-decode from the layouts cerdeb writes to
+// cerdeb.meta. The buffer of a thread goes to the log file when it is full or
+// when the thread calls cerdeb_log_flush.
+//
+// Once cerdeb_async_start is called the records go instead to a lock-free
+// single-producer ring owned by the calling thread, so Name_log costs a
+// bounded copy and an atomic store. A background thread drains all the rings
+// and writes the records out in batches, either as they are (binary mode) or
+// formatted with the generated printers (text mode). A record that doesn't
+// fit in its ring is dropped and counted, the producer never blocks.
+//
+// log file: "CERDEBL1" followed by records
+// record:   u32 type id, u32 payload size, payload
+// payload:  the fields in declaration order, without padding, in the byte
+//           order of the host. Strings are a u32 length (UINT32_MAX for NULL)
+//           followed by the bytes and a terminating 0
+
+#include <stdatomic.h>
+
+#define CERDEB_LOG_MAGIC "CERDEBL1"
+#define CERDEB_LOG_HEADER_SIZE 8
+#define CERDEB_LOG_NULL_STR UINT32_MAX
+
+#ifndef CERDEB_LOG_BUFFER
+#define CERDEB_LOG_BUFFER (1 << 16)
+#endif
+
+typedef struct Cerdeb_Log_Buffer {
+    char* items;
+    size_t count;
+    size_t capacity;
+    struct Cerdeb_Log_Buffer* next; // in the list of the buffers of the live threads
+} Cerdeb_Log_Buffer;
+
+extern CERDEB_THREAD_LOCAL Cerdeb_Log_Buffer cerdeb__log_buffer;
+
+#ifndef CERDEB_RING_SIZE
+#define CERDEB_RING_SIZE (1 << 20) // per thread, a power of two
+#endif
+
+typedef enum {
+    CERDEB_ASYNC_TEXT,
+    CERDEB_ASYNC_BINARY,
+} Cerdeb_Async_Mode;
+
+// formats the record `payload` followed by a new line at `p`, returns NULL
+// if it doesn't fit before `end`
+typedef char* (*Cerdeb_Render)(char* p, char* end, const char* payload);
+
+// the text mode skips the records of types whose printers are compiled out
+#if CERDEB_PRINTERS
+#define CERDEB_RENDER(render) (render)
+#else
+#define CERDEB_RENDER(render) NULL
+#endif
+
+typedef struct Cerdeb_Ring Cerdeb_Ring;
+
+extern _Atomic bool cerdeb__async_running;
+extern CERDEB_THREAD_LOCAL Cerdeb_Ring* cerdeb__ring_pending;
+
+bool cerdeb_log_open(const char* path);
+void cerdeb_log_flush(void);
+void cerdeb_log_close(void);
+bool cerdeb__log_make_room(size_t size);
+
+// `fd` receives the text or the binary log, cerdeb_async_stop drains the
+// rings and has to be called once the producers are done
+bool cerdeb_async_start(int fd, Cerdeb_Async_Mode mode);
+void cerdeb_async_stop(void);
+size_t cerdeb_async_dropped(void);
+char* cerdeb__ring_reserve(uint32_t type_id, uint32_t size, Cerdeb_Render render);
+void cerdeb__ring_commit(void);
+
+// a record logged while the backend starts or stops may go either way
+static inline char* cerdeb_log_reserve(uint32_t type_id, uint32_t size, Cerdeb_Render render) {
+    if (atomic_load_explicit(&cerdeb__async_running, memory_order_relaxed)) return cerdeb__ring_reserve(type_id, size, render);
+
+    Cerdeb_Log_Buffer* buf = &cerdeb__log_buffer;
+    size_t needed = CERDEB_LOG_HEADER_SIZE + (size_t)size;
+    if (buf->capacity - buf->count < needed && !cerdeb__log_make_room(needed)) return NULL;
+
+    char* p = buf->items + buf->count;
+    memcpy(p, &type_id, 4);
+    memcpy(p + 4, &size, 4);
+    buf->count += needed;
+    return p + CERDEB_LOG_HEADER_SIZE;
+}
+
+// publishes the record of the last cerdeb_log_reserve
+static inline void cerdeb_log_commit(void) {
+    if (cerdeb__ring_pending) cerdeb__ring_commit();
+}
+
+static inline char* cerdeb_pack_i32(char* p, int32_t v) { memcpy(p, &v, 4); return p + 4; }
+static inline char* cerdeb_pack_i64(char* p, int64_t v) { memcpy(p, &v, 8); return p + 8; }
+static inline char* cerdeb_pack_u64(char* p, uint64_t v) { memcpy(p, &v, 8); return p + 8; }
+static inline char* cerdeb_pack_f32(char* p, float v) { memcpy(p, &v, 4); return p + 4; }
+static inline char* cerdeb_pack_f64(char* p, double v) { memcpy(p, &v, 8); return p + 8; }
+static inline char* cerdeb_pack_char(char* p, char v) { *p = v; return p + 1; }
+
+static inline char* cerdeb_pack_ptr(char* p, const void* v) {
+    uint64_t u = (uint64_t)(uintptr_t)v;
+    memcpy(p, &u, 8);
+    return p + 8;
+}
+
+// the length prefix is part of the fixed size of a record
+static inline size_t cerdeb_pack_str_size(const char* s) {
+    return s ? strlen(s) + 1 : 0;
+}
+
+static inline char* cerdeb_pack_u32(char* p, uint32_t v) { memcpy(p, &v, 4); return p + 4; }
+
+// char[N] fields are packed like strings
+static inline size_t cerdeb_pack_chars_size(const char* s, size_t n) {
+    return cerdeb_chars_len(s, n) + 1;
+}
+
+static inline char* cerdeb_pack_chars(char* p, const char* s, size_t n) {
+    uint32_t len = (uint32_t)cerdeb_chars_len(s, n);
+    memcpy(p, &len, 4);
+    memcpy(p + 4, s, len);
+    p[4 + len] = '\0';
+    return p + 4 + len + 1;
+}
+
+static inline size_t cerdeb_pack_strn_size(const char* s, size_t n) {
+    return s ? n + 1 : 0;
+}
+
+// the first `n` characters of `s`, unpacked like any other string
+static inline char* cerdeb_pack_strn(char* p, const char* s, size_t n) {
+    uint32_t len = s ? (uint32_t)n : CERDEB_LOG_NULL_STR;
+    memcpy(p, &len, 4);
+    if (s == NULL) return p + 4;
+    memcpy(p + 4, s, n);
+    p[4 + n] = '\0';
+    return p + 4 + n + 1;
+}
+
+static inline char* cerdeb_pack_str(char* p, const char* s) {
+    uint32_t len = s ? (uint32_t)strlen(s) : CERDEB_LOG_NULL_STR;
+    memcpy(p, &len, 4);
+    if (s == NULL) return p + 4;
+    memcpy(p + 4, s, len + 1);
+    return p + 4 + len + 1;
+}
+
+static inline const char* cerdeb_unpack_i32(const char* p, int32_t* v) { memcpy(v, p, 4); return p + 4; }
+static inline const char* cerdeb_unpack_i64(const char* p, int64_t* v) { memcpy(v, p, 8); return p + 8; }
+static inline const char* cerdeb_unpack_u64(const char* p, uint64_t* v) { memcpy(v, p, 8); return p + 8; }
+static inline const char* cerdeb_unpack_f32(const char* p, float* v) { memcpy(v, p, 4); return p + 4; }
+static inline const char* cerdeb_unpack_f64(const char* p, double* v) { memcpy(v, p, 8); return p + 8; }
+static inline const char* cerdeb_unpack_char(const char* p, char* v) { *v = *p; return p + 1; }
+
+static inline const char* cerdeb_unpack_ptr(const char* p, void** v) {
+    uint64_t u;
+    memcpy(&u, p, 8);
+    *v = (void*)(uintptr_t)u;
+    return p + 8;
+}
+
+static inline const char* cerdeb_unpack_u32(const char* p, uint32_t* v) { memcpy(v, p, 4); return p + 4; }
+
+// the string is cut at `n` characters, padded with 0s if it is shorter
+static inline const char* cerdeb_unpack_chars(const char* p, char* s, size_t n) {
+    uint32_t len;
+    memcpy(&len, p, 4);
+    memset(s, 0, n);
+    if (len == CERDEB_LOG_NULL_STR) return p + 4;
+    memcpy(s, p + 4, len < n ? len : n);
+    return p + 4 + len + 1;
+}
+
+// the string points into the record
+static inline const char* cerdeb_unpack_str(const char* p, char** v) {
+    uint32_t len;
+    memcpy(&len, p, 4);
+    if (len == CERDEB_LOG_NULL_STR) {
+        *v = NULL;
+        return p + 4;
+    }
+    *v = (char*)p + 4;
+    return p + 4 + len + 1;
+}
+
+// Crash-surviving flight recorder.
+//
+// cerdeb_flight_open maps a file with a fixed number of fixed-size slots and
+// Name_flight packs its struct into the next slot, exactly like Name_log
+// does, overwriting the oldest one. The mapping is shared with the page
+// cache, so the last snapshots survive a crash or a SIGKILL of the process
+// (not a power loss) and cerdeb-decode reads them back in order. Opening a
+// file with the same slot size and count again keeps its records, the new
+// ones follow them, any other file is started over.
+//
+// flight file: header of CERDEB_FLIGHT_HEADER_SIZE bytes ("CERDEBF1", u32
+//              slot size, u32 slot count, u64 next sequence number) followed
+//              by the slots
+// slot:        u64 sequence number + 1 (0 while the slot is being written),
+//              u32 type id, u32 payload size, payload
+
+#define CERDEB_FLIGHT_MAGIC "CERDEBF1"
+#define CERDEB_FLIGHT_HEADER_SIZE 64
+#define CERDEB_FLIGHT_SLOT_HEADER 16
+
+bool cerdeb_flight_open(const char* path, size_t slots, size_t slot_size);
+void cerdeb_flight_close(void);
+char* cerdeb_flight_reserve(uint32_t type_id, uint32_t size);
+void cerdeb_flight_commit(char* payload);
+
+#endif // CERDEB_H_
+
+#ifdef CERDEB_IMPLEMENTATION
+#ifndef CERDEB_IMPLEMENTATION_DONE_
+#define CERDEB_IMPLEMENTATION_DONE_
+
+#include <stdio.h>
+
+int cerdeb_level = CERDEB_LEVEL;
+Cerdeb_Sink cerdeb_sink = cerdeb_sink_stderr;
+
+void cerdeb_sink_stderr(int level, const char* text, size_t len) {
+    (void)level;
+    fwrite(text, 1, len, stderr);
+}
+
+CERDEB_THREAD_LOCAL Cerdeb_Follow cerdeb__follow = {0};
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+static int cerdeb__log_fd = -1;
+CERDEB_THREAD_LOCAL Cerdeb_Log_Buffer cerdeb__log_buffer = {0};
+static pthread_mutex_t cerdeb__log_lock = PTHREAD_MUTEX_INITIALIZER;
+static Cerdeb_Log_Buffer* cerdeb__log_buffers = NULL;
+
+// A thread that logs is watched with a pthread key whose destructor hands
+// back its log buffer and its ring when it exits. The value of the key only
+// has to be non-NULL for the destructor to run.
+static pthread_key_t cerdeb__thread_key;
+static pthread_once_t cerdeb__thread_key_once = PTHREAD_ONCE_INIT;
+
+static void cerdeb__thread_exit(void* arg);
+
+static void cerdeb__thread_key_create(void) {
+    pthread_key_create(&cerdeb__thread_key, cerdeb__thread_exit);
+}
+
+static void cerdeb__watch_thread(void) {
+    pthread_once(&cerdeb__thread_key_once, cerdeb__thread_key_create);
+    pthread_setspecific(cerdeb__thread_key, &cerdeb__log_buffer);
+}
+
+static bool cerdeb__write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool cerdeb_log_open(const char* path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd < 0) return false;
+
+    if (!cerdeb__write_all(fd, CERDEB_LOG_MAGIC, strlen(CERDEB_LOG_MAGIC))) {
+        close(fd);
+        return false;
+    }
+
+    cerdeb__log_fd = fd;
+    return true;
+}
+
+// with cerdeb__log_lock held, O_APPEND keeps the buffers of different
+// threads from overlapping
+static void cerdeb__log_flush_buffer(Cerdeb_Log_Buffer* buf) {
+    if (buf->count > 0 && cerdeb__log_fd >= 0) cerdeb__write_all(cerdeb__log_fd, buf->items, buf->count);
+    buf->count = 0;
+}
+
+void cerdeb_log_flush(void) {
+    pthread_mutex_lock(&cerdeb__log_lock);
+    cerdeb__log_flush_buffer(&cerdeb__log_buffer);
+    pthread_mutex_unlock(&cerdeb__log_lock);
+}
+
+// the other threads have to be done logging, their buffers are written as
+// they are
+void cerdeb_log_close(void) {
+    pthread_mutex_lock(&cerdeb__log_lock);
+    for (Cerdeb_Log_Buffer* buf = cerdeb__log_buffers; buf != NULL; buf = buf->next) {
+        cerdeb__log_flush_buffer(buf);
+    }
+    if (cerdeb__log_fd >= 0) close(cerdeb__log_fd);
+    cerdeb__log_fd = -1;
+    pthread_mutex_unlock(&cerdeb__log_lock);
+}
+
+// the records of an exiting thread are written out before its buffer goes
+static void cerdeb__log_release(void) {
+    Cerdeb_Log_Buffer* buf = &cerdeb__log_buffer;
+    if (buf->items == NULL) return;
+
+    pthread_mutex_lock(&cerdeb__log_lock);
+    cerdeb__log_flush_buffer(buf);
+    for (Cerdeb_Log_Buffer** it = &cerdeb__log_buffers; *it != NULL; it = &(*it)->next) {
+        if (*it == buf) {
+            *it = buf->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cerdeb__log_lock);
+
+    free(buf->items);
+    *buf = (Cerdeb_Log_Buffer){0};
+}
+
+bool cerdeb__log_make_room(size_t size) {
+    if (cerdeb__log_fd < 0) return false;
+    cerdeb_log_flush();
+
+    Cerdeb_Log_Buffer* buf = &cerdeb__log_buffer;
+    if (buf->capacity < size) {
+        size_t capacity = size > CERDEB_LOG_BUFFER ? size : CERDEB_LOG_BUFFER;
+        char* items = (char*)realloc(buf->items, capacity);
+        if (items == NULL) return false;
+
+        // the first buffer of the thread
+        if (buf->items == NULL) {
+            pthread_mutex_lock(&cerdeb__log_lock);
+            buf->next = cerdeb__log_buffers;
+            cerdeb__log_buffers = buf;
+            pthread_mutex_unlock(&cerdeb__log_lock);
+            cerdeb__watch_thread();
+        }
+        buf->items = items;
+        buf->capacity = capacity;
+    }
+    return true;
+}
+
+// ring entry: u32 payload size, u32 type id, the render function, the
+// payload, padded to 8 bytes. An entry that would cross the end of the ring
+// is preceded by a padding entry that fills it up.
+#define CERDEB__RING_ENTRY_HEADER 16
+#define CERDEB__RING_PADDING 0x80000000u
+
+struct Cerdeb_Ring {
+    _Atomic size_t head; // written by the producer
+    _Atomic size_t tail; // written by the background thread
+    size_t pending;
+    size_t dropped;
+    char* data;
+    _Atomic bool abandoned; // its thread exited, the next new producer takes it over
+    Cerdeb_Ring* next;
+};
+
+_Atomic bool cerdeb__async_running = false;
+CERDEB_THREAD_LOCAL Cerdeb_Ring* cerdeb__ring_pending = NULL;
+static CERDEB_THREAD_LOCAL Cerdeb_Ring* cerdeb__ring = NULL;
+static _Atomic(Cerdeb_Ring*) cerdeb__rings = NULL;
+static _Atomic bool cerdeb__async_stopping = false;
+static pthread_t cerdeb__async_thread;
+static int cerdeb__async_fd = -1;
+static Cerdeb_Async_Mode cerdeb__async_mode;
+
+// the rings stay in the list, the background thread and cerdeb_async_dropped
+// walk it without a lock, so the ring of an exited thread is handed to the
+// next thread that logs. It keeps the records that weren't drained yet, in
+// front of the ones of its new producer.
+static void cerdeb__ring_abandon(void) {
+    if (cerdeb__ring == NULL) return;
+    atomic_store_explicit(&cerdeb__ring->abandoned, true, memory_order_release);
+    cerdeb__ring = NULL;
+}
+
+static Cerdeb_Ring* cerdeb__ring_take_over(void) {
+    for (Cerdeb_Ring* ring = atomic_load(&cerdeb__rings); ring != NULL; ring = ring->next) {
+        bool abandoned = true;
+        if (atomic_load_explicit(&ring->abandoned, memory_order_relaxed) &&
+            atomic_compare_exchange_strong_explicit(&ring->abandoned, &abandoned, false, memory_order_acquire, memory_order_relaxed)) {
+            return ring;
+        }
+    }
+    return NULL;
+}
+
+static Cerdeb_Ring* cerdeb__ring_register(void) {
+    Cerdeb_Ring* ring = cerdeb__ring_take_over();
+    if (ring == NULL) {
+        ring = (Cerdeb_Ring*)calloc(1, sizeof(*ring));
+        if (ring == NULL) return NULL;
+        ring->data = (char*)malloc(CERDEB_RING_SIZE);
+        if (ring->data == NULL) {
+            free(ring);
+            return NULL;
+        }
+
+        Cerdeb_Ring* head = atomic_load(&cerdeb__rings);
+        do {
+            ring->next = head;
+        } while (!atomic_compare_exchange_weak(&cerdeb__rings, &head, ring));
+    }
+
+    cerdeb__watch_thread();
+    return ring;
+}
+
+char* cerdeb__ring_reserve(uint32_t type_id, uint32_t size, Cerdeb_Render render) {
+    Cerdeb_Ring* ring = cerdeb__ring;
+    if (ring == NULL) ring = cerdeb__ring = cerdeb__ring_register();
+    if (ring == NULL) return NULL;
+
+    size_t total = (CERDEB__RING_ENTRY_HEADER + (size_t)size + 7) & ~(size_t)7;
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t offset = head & (CERDEB_RING_SIZE - 1);
+    size_t padding = CERDEB_RING_SIZE - offset < total ? CERDEB_RING_SIZE - offset : 0;
+
+    if (CERDEB_RING_SIZE - (head - tail) < padding + total) {
+        ring->dropped++;
+        return NULL;
+    }
+
+    if (padding > 0) {
+        uint32_t pad = CERDEB__RING_PADDING | (uint32_t)padding;
+        memcpy(ring->data + offset, &pad, 4);
+        head += padding;
+        offset = 0;
+    }
+
+    char* entry = ring->data + offset;
+    memcpy(entry, &size, 4);
+    memcpy(entry + 4, &type_id, 4);
+    memcpy(entry + 8, &render, sizeof(render));
+    ring->pending = head + total;
+    cerdeb__ring_pending = ring;
+    return entry + CERDEB__RING_ENTRY_HEADER;
+}
+
+void cerdeb__ring_commit(void) {
+    Cerdeb_Ring* ring = cerdeb__ring_pending;
+    atomic_store_explicit(&ring->head, ring->pending, memory_order_release);
+    cerdeb__ring_pending = NULL;
+}
+
+static bool cerdeb__async_emit(Cerdeb_Log_Buffer* out, uint32_t type_id, uint32_t size, Cerdeb_Render render, const char* payload) {
+    for (;;) {
+        char* p = out->items + out->count;
+        char* end = out->items + out->capacity;
+
+        if (cerdeb__async_mode == CERDEB_ASYNC_BINARY) {
+            if ((size_t)(end - p) >= CERDEB_LOG_HEADER_SIZE + size) {
+                memcpy(p, &type_id, 4);
+                memcpy(p + 4, &size, 4);
+                memcpy(p + CERDEB_LOG_HEADER_SIZE, payload, size);
+                out->count += CERDEB_LOG_HEADER_SIZE + size;
+                return true;
+            }
+        } else if (render == NULL) {
+            return true;
+        } else {
+            p = render(p, end, payload);
+            if (p != NULL) {
+                out->count = p - out->items;
+                return true;
+            }
+        }
+
+        if (out->count > 0) {
+            if (!cerdeb__write_all(cerdeb__async_fd, out->items, out->count)) return false;
+            out->count = 0;
+            continue;
+        }
+
+        // a single record bigger than the whole buffer
+        size_t capacity = out->capacity ? out->capacity * 2 : CERDEB_LOG_BUFFER;
+        char* items = (char*)realloc(out->items, capacity);
+        if (items == NULL) return false;
+        out->items = items;
+        out->capacity = capacity;
+    }
+}
+
+static size_t cerdeb__async_drain(Cerdeb_Log_Buffer* out) {
+    size_t drained = 0;
+
+    for (Cerdeb_Ring* ring = atomic_load(&cerdeb__rings); ring != NULL; ring = ring->next) {
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+        while (tail != head) {
+            char* entry = ring->data + (tail & (CERDEB_RING_SIZE - 1));
+            uint32_t size;
+            memcpy(&size, entry, 4);
+
+            if (size & CERDEB__RING_PADDING) {
+                tail += size & ~CERDEB__RING_PADDING;
+                continue;
+            }
+
+            uint32_t type_id;
+            Cerdeb_Render render;
+            memcpy(&type_id, entry + 4, 4);
+            memcpy(&render, entry + 8, sizeof(render));
+            cerdeb__async_emit(out, type_id, size, render, entry + CERDEB__RING_ENTRY_HEADER);
+
+            tail += (CERDEB__RING_ENTRY_HEADER + (size_t)size + 7) & ~(size_t)7;
+            drained++;
+        }
+
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+
+    if (out->count > 0) {
+        cerdeb__write_all(cerdeb__async_fd, out->items, out->count);
+        out->count = 0;
+    }
+    return drained;
+}
+
+static void* cerdeb__async_loop(void* arg) {
+    (void)arg;
+    Cerdeb_Log_Buffer out = {0};
+
+    while (!atomic_load(&cerdeb__async_stopping)) {
+        if (cerdeb__async_drain(&out) == 0) {
+            struct timespec idle = { 0, 1000000 };
+            nanosleep(&idle, NULL);
+        }
+    }
+
+    while (cerdeb__async_drain(&out) > 0) {}
+    free(out.items);
+    return NULL;
+}
+
+bool cerdeb_async_start(int fd, Cerdeb_Async_Mode mode) {
+    if (atomic_load_explicit(&cerdeb__async_running, memory_order_acquire)) return false;
+    if (mode == CERDEB_ASYNC_BINARY && !cerdeb__write_all(fd, CERDEB_LOG_MAGIC, strlen(CERDEB_LOG_MAGIC))) return false;
+
+    cerdeb__async_fd = fd;
+    cerdeb__async_mode = mode;
+    atomic_store(&cerdeb__async_stopping, false);
+    if (pthread_create(&cerdeb__async_thread, NULL, cerdeb__async_loop, NULL) != 0) return false;
+
+    atomic_store_explicit(&cerdeb__async_running, true, memory_order_release);
+    return true;
+}
+
+void cerdeb_async_stop(void) {
+    if (!atomic_exchange_explicit(&cerdeb__async_running, false, memory_order_acq_rel)) return;
+    atomic_store(&cerdeb__async_stopping, true);
+    pthread_join(cerdeb__async_thread, NULL);
+}
+
+size_t cerdeb_async_dropped(void) {
+    size_t dropped = 0;
+    for (Cerdeb_Ring* ring = atomic_load(&cerdeb__rings); ring != NULL; ring = ring->next) {
+        dropped += ring->dropped;
+    }
+    return dropped;
+}
+
+static void cerdeb__thread_exit(void* arg) {
+    (void)arg;
+    cerdeb__log_release();
+    cerdeb__ring_abandon();
+}
+
+typedef struct {
+    char magic[8];
+    uint32_t slot_size;
+    uint32_t slots;
+    _Atomic uint64_t next;
+} Cerdeb_Flight_Header;
+
+static Cerdeb_Flight_Header* cerdeb__flight = NULL;
+static size_t cerdeb__flight_size = 0;
+static CERDEB_THREAD_LOCAL uint64_t cerdeb__flight_seq = 0;
+
+bool cerdeb_flight_open(const char* path, size_t slots, size_t slot_size) {
+    if (cerdeb__flight != NULL || slots == 0 || slot_size <= CERDEB_FLIGHT_SLOT_HEADER) return false;
+
+    slot_size = (slot_size + 7) & ~(size_t)7;
+    size_t size = CERDEB_FLIGHT_HEADER_SIZE + slots * slot_size;
+
+    // no O_TRUNC, the records of the previous run are what a restart after
+    // a crash is looking for
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || ((size_t)st.st_size != size && (ftruncate(fd, 0) < 0 || ftruncate(fd, (off_t)size) < 0))) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    Cerdeb_Flight_Header* header = (Cerdeb_Flight_Header*)data;
+    if (memcmp(header->magic, CERDEB_FLIGHT_MAGIC, 8) != 0 || header->slot_size != slot_size || header->slots != slots) {
+        memset(data, 0, size);
+        memcpy(header->magic, CERDEB_FLIGHT_MAGIC, 8);
+        header->slot_size = (uint32_t)slot_size;
+        header->slots = (uint32_t)slots;
+        atomic_store(&header->next, 0);
+    }
+
+    cerdeb__flight_size = size;
+    cerdeb__flight = header;
+    return true;
+}
+
+void cerdeb_flight_close(void) {
+    if (cerdeb__flight == NULL) return;
+    munmap(cerdeb__flight, cerdeb__flight_size);
+    cerdeb__flight = NULL;
+}
+
+char* cerdeb_flight_reserve(uint32_t type_id, uint32_t size) {
+    Cerdeb_Flight_Header* header = cerdeb__flight;
+    if (header == NULL || CERDEB_FLIGHT_SLOT_HEADER + (size_t)size > header->slot_size) return NULL;
+
+    uint64_t seq = atomic_fetch_add_explicit(&header->next, 1, memory_order_relaxed);
+    char* slot = (char*)header + CERDEB_FLIGHT_HEADER_SIZE + (seq % header->slots) * header->slot_size;
+
+    // invalidate the slot first so a crash in the middle leaves no torn record
+    atomic_store_explicit((_Atomic uint64_t*)slot, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(slot + 8, &type_id, 4);
+    memcpy(slot + 12, &size, 4);
+
+    cerdeb__flight_seq = seq + 1;
+    return slot + CERDEB_FLIGHT_SLOT_HEADER;
+}
+
+void cerdeb_flight_commit(char* payload) {
+    char* slot = payload - CERDEB_FLIGHT_SLOT_HEADER;
+    atomic_store_explicit((_Atomic uint64_t*)slot, cerdeb__flight_seq, memory_order_release);
+}
+#endif // _WIN32
+
+#endif // CERDEB_IMPLEMENTATION_DONE_
+#endif // CERDEB_IMPLEMENTATION
@@ -0,0 +1,518 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NOB_STRIP_PREFIX
+#define NOB_IMPLEMENTATION
+#include "../extern/nob.h"
+
+#include "cerdeb.h"
+
+// input bytes decoded by one thread in one round
+#define DECODE_CHUNK (16 << 20)
+
+typedef enum {
+    KIND_BOGUS,
+    KIND_I32,
+    KIND_I64,
+    KIND_F64,
+    KIND_STR,
+    KIND_PTR,
+    KIND_CHAR,
+    KIND_F32,
+    KIND_STRUCT,
+    KIND_X32, // `!hex` integers
+    KIND_X64,
+    KIND_U32,
+    KIND_U64,
+    KIND_ENUM,
+} Kind;
+
+// NOTE: has to match `kinds` and `field_kind` in main.c, nested structs are
+// "struct:Name" and enums "enum:Name"
+static const char* kind_names[] = {
+    NULL, "i32", "i64", "f64", "str", "ptr", "char", "f32", NULL, "x32", "x64",
+    "u32", "u64", NULL
+};
+
+// size of the packed field and upper bound of the formatted field, the
+// contents of a string are bounded by the payload but a NULL one prints
+// "(null)" from the 4 bytes of its length
+static const size_t kind_sizes[] = { 0, 4, 8, 8, 4, 8, 1, 4, 0, 4, 8, 4, 8, 8 };
+static const size_t kind_max_lens[] = {
+    0, CERDEB_I32_MAX_LEN, CERDEB_I64_MAX_LEN, CERDEB_F64_MAX_LEN, CERDEB_STR_MAX_LEN(0),
+    CERDEB_PTR_MAX_LEN, CERDEB_CHAR_MAX_LEN, CERDEB_F32_MAX_LEN, 0,
+    CERDEB_HEX32_MAX_LEN, CERDEB_HEX64_MAX_LEN, CERDEB_U32_MAX_LEN, CERDEB_U64_MAX_LEN, 0
+};
+
+typedef struct {
+    int64_t value;
+    Cerdeb_Name name;
+} Meta_Value;
+
+// sorted by value once its "end" is read
+typedef struct {
+    const char* name;
+    Cerdeb_Name cast; // "(Name)", before the values without a name
+    size_t max_len; // of the longest name or of the cast and a number
+    Meta_Value* items;
+    size_t count;
+    size_t capacity;
+} Meta_Enum;
+
+typedef struct {
+    Meta_Enum** items;
+    size_t count;
+    size_t capacity;
+} Meta_Enums;
+
+typedef struct Meta_Type Meta_Type;
+
+typedef struct {
+    const char* name;
+    Kind kind;
+    const char* type_name; // of KIND_STRUCT fields
+    Meta_Type* type;
+    Meta_Enum* values; // of KIND_ENUM fields
+    bool array; // "kind[]", a u32 count followed by the elements
+} Meta_Field;
+
+struct Meta_Type {
+    uint32_t id;
+    const char* name;
+    size_t max_len; // everything but the contents of the strings
+    bool resolving;
+    Meta_Field* items;
+    size_t count;
+    size_t capacity;
+};
+
+typedef struct {
+    Meta_Type* items;
+    size_t count;
+    size_t capacity;
+} Meta_Types;
+
+Meta_Types types = {0};
+Meta_Enums enums = {0};
+
+Kind parse_kind(const char* name) {
+    if (strncmp(name, "struct:", 7) == 0) return KIND_STRUCT;
+    if (strncmp(name, "enum:", 5) == 0) return KIND_ENUM;
+    for (size_t i = 1; i < ARRAY_LEN(kind_names); ++i) {
+        if (kind_names[i] && strcmp(name, kind_names[i]) == 0) return (Kind)i;
+    }
+    return KIND_BOGUS;
+}
+
+int compare_types(const void* a, const void* b) {
+    uint32_t x = ((const Meta_Type*)a)->id;
+    uint32_t y = ((const Meta_Type*)b)->id;
+    return (x > y) - (x < y);
+}
+
+int compare_values(const void* a, const void* b) {
+    int64_t x = ((const Meta_Value*)a)->value;
+    int64_t y = ((const Meta_Value*)b)->value;
+    return (x > y) - (x < y);
+}
+
+// the enums come before the structs using them in cerdeb.meta
+Meta_Enum* find_enum(const char* name) {
+    for (size_t i = 0; i < enums.count; ++i) {
+        if (strcmp(enums.items[i]->name, name) == 0) return enums.items[i];
+    }
+    return NULL;
+}
+
+// links the nested structs of `type` and adds their bound to its own
+bool resolve_type(Meta_Type* type) {
+    if (type->resolving) {
+        nob_log(ERROR, "%s contains itself", type->name);
+        return false;
+    }
+
+    type->resolving = true;
+    for (size_t i = 0; i < type->count; ++i) {
+        Meta_Field* f = &type->items[i];
+        if (f->kind != KIND_STRUCT || f->type != NULL) continue;
+
+        for (size_t j = 0; j < types.count && f->type == NULL; ++j) {
+            if (strcmp(types.items[j].name, f->type_name) == 0) f->type = &types.items[j];
+        }
+        if (f->type == NULL) {
+            nob_log(ERROR, "%s.%s: %s is not derived with !log", type->name, f->name, f->type_name);
+            return false;
+        }
+
+        if (!resolve_type(f->type)) return false;
+        type->max_len += f->type->max_len;
+    }
+    type->resolving = false;
+    return true;
+}
+
+bool parse_meta(const char* path) {
+    String_Builder file = {0};
+    if (!read_entire_file(path, &file)) return false;
+
+    String_View content = sv_from_parts(file.items, file.count);
+    Meta_Type* type = NULL;
+    Meta_Enum* values = NULL;
+    size_t line_number = 0;
+
+    while (content.count > 0) {
+        String_View line = sv_trim(sv_chop_by_delim(&content, '\n'));
+        ++line_number;
+        if (line.count == 0) continue;
+
+        char a[256], b[256];
+        temp_reset();
+        const char* cline = temp_sv_to_cstr(line);
+        unsigned id;
+        long long value;
+
+        if (values && sscanf(cline, "value %lld %255s", &value, a) == 2) {
+            Meta_Value v = { .value = value, .name = { strdup(a), strlen(a) } };
+            if (v.name.len > values->max_len) values->max_len = v.name.len;
+            da_append(values, v);
+        } else if (values && strcmp(cline, "end") == 0) {
+            qsort(values->items, values->count, sizeof(*values->items), compare_values);
+            values = NULL;
+        } else if (sscanf(cline, "enum %255s", a) == 1) {
+            values = calloc(1, sizeof(*values));
+            values->name = strdup(a);
+            values->cast.text = strdup(temp_sprintf("(%s)", a));
+            values->cast.len = strlen(a) + 2;
+            values->max_len = values->cast.len + CERDEB_I64_MAX_LEN;
+            da_append(&enums, values);
+        } else if (sscanf(cline, "type 0x%x %255s", &id, a) == 2) {
+            Meta_Type t = { .id = id, .name = strdup(a) };
+            t.max_len = strlen(a) + strlen(" { }");
+            da_append(&types, t);
+            type = &da_last(&types);
+        } else if (type && sscanf(cline, "field %255s %255s", a, b) == 2) {
+            size_t len = strlen(b);
+            bool array = len > 2 && strcmp(b + len - 2, "[]") == 0;
+            if (array) b[len - 2] = '\0';
+
+            Meta_Field f = { .name = strdup(a), .kind = parse_kind(b), .array = array };
+            if (f.kind == KIND_BOGUS || (array && (f.kind == KIND_STR || f.kind == KIND_STRUCT))) {
+                nob_log(ERROR, "%s:%zu: unknown field kind %s%s", path, line_number, b, array ? "[]" : "");
+                return false;
+            }
+            if (f.kind == KIND_STRUCT) f.type_name = strdup(b + 7);
+
+            size_t max_len = kind_max_lens[f.kind];
+            if (f.kind == KIND_ENUM) {
+                f.values = find_enum(b + 5);
+                if (f.values == NULL) {
+                    nob_log(ERROR, "%s:%zu: %s is not a derived enum", path, line_number, b + 5);
+                    return false;
+                }
+                max_len = f.values->max_len;
+            }
+
+            // only the first CERDEB_ARRAY_CAP elements are printed
+            if (array) max_len = CERDEB_ARRAY_MAX_LEN(CERDEB_ARRAY_CAP, max_len);
+            type->max_len += strlen(", . = ") + strlen(f.name) + max_len;
+            da_append(type, f);
+        } else if (type && strcmp(cline, "end") == 0) {
+            type = NULL;
+        } else {
+            nob_log(ERROR, "%s:%zu: unexpected line", path, line_number);
+            return false;
+        }
+    }
+
+    qsort(types.items, types.count, sizeof(*types.items), compare_types);
+    for (size_t i = 0; i < types.count; ++i) {
+        if (!resolve_type(&types.items[i])) return false;
+    }
+
+    sb_free(file);
+    return true;
+}
+
+Meta_Type* find_type(uint32_t id) {
+    Meta_Type key = { .id = id };
+    return bsearch(&key, types.items, types.count, sizeof(*types.items), compare_types);
+}
+
+char* render_fields(char* p, Meta_Type* type, const char** payload_at, const char* end);
+
+// one value of the kind of `f`, NULL if the payload is malformed
+char* render_value(char* p, Meta_Field f, const char** payload_at, const char* end) {
+    const char* payload = *payload_at;
+    if ((size_t)(end - payload) < kind_sizes[f.kind]) return NULL;
+    switch (f.kind) {
+        case KIND_I32: { int32_t v; payload = cerdeb_unpack_i32(payload, &v); p = cerdeb_write_i32(p, v); } break;
+        case KIND_I64: { int64_t v; payload = cerdeb_unpack_i64(payload, &v); p = cerdeb_write_i64(p, v); } break;
+        case KIND_F64: { double v; payload = cerdeb_unpack_f64(payload, &v); p = cerdeb_write_f64(p, v); } break;
+        case KIND_F32: { float v; payload = cerdeb_unpack_f32(payload, &v); p = cerdeb_write_f32(p, v); } break;
+        case KIND_CHAR: { char v; payload = cerdeb_unpack_char(payload, &v); p = cerdeb_write_char(p, v); } break;
+        case KIND_PTR: { void* v; payload = cerdeb_unpack_ptr(payload, &v); p = cerdeb_write_ptr(p, v); } break;
+        case KIND_X32: { int32_t v; payload = cerdeb_unpack_i32(payload, &v); p = cerdeb_write_hex(p, (uint32_t)v); } break;
+        case KIND_U32: { uint32_t v; payload = cerdeb_unpack_u32(payload, &v); p = cerdeb_write_u64(p, v); } break;
+        case KIND_U64: { uint64_t v; payload = cerdeb_unpack_u64(payload, &v); p = cerdeb_write_u64(p, v); } break;
+        case KIND_X64: { int64_t v; payload = cerdeb_unpack_i64(payload, &v); p = cerdeb_write_hex(p, (uint64_t)v); } break;
+        case KIND_STR: {
+            uint32_t len;
+            memcpy(&len, payload, 4);
+            if (len != CERDEB_LOG_NULL_STR && (size_t)(end - payload) < 4 + (size_t)len + 1) return NULL;
+            char* v;
+            payload = cerdeb_unpack_str(payload, &v);
+            p = v ? cerdeb_write_lit(p, v, len) : cerdeb_write_str(p, v);
+        } break;
+        case KIND_STRUCT: {
+            p = render_fields(p, f.type, &payload, end);
+            if (p == NULL) return NULL;
+        } break;
+        case KIND_ENUM: {
+            Meta_Value key;
+            payload = cerdeb_unpack_i64(payload, &key.value);
+            Meta_Value* v = bsearch(&key, f.values->items, f.values->count, sizeof(key), compare_values);
+            p = cerdeb_write_enum(p, v ? v->name : (Cerdeb_Name){0}, f.values->cast.text, f.values->cast.len, key.value);
+        } break;
+        default: UNREACHABLE("kind");
+    }
+
+    *payload_at = payload;
+    return p;
+}
+
+// same layout as the generated Name_debug_write, NULL if the payload is malformed
+char* render_fields(char* p, Meta_Type* type, const char** payload_at, const char* end) {
+    const char* payload = *payload_at;
+    p = cerdeb_write_lit(p, type->name, strlen(type->name));
+    p = cerdeb_write_lit(p, " {", 2);
+
+    for (size_t i = 0; i < type->count; ++i) {
+        Meta_Field f = type->items[i];
+        if (i != 0) *p++ = ',';
+        p = cerdeb_write_lit(p, " .", 2);
+        p = cerdeb_write_lit(p, f.name, strlen(f.name));
+        p = cerdeb_write_lit(p, " = ", 3);
+
+        if (!f.array) {
+            p = render_value(p, f, &payload, end);
+            if (p == NULL) return NULL;
+            continue;
+        }
+
+        uint32_t count;
+        if ((size_t)(end - payload) < 4) return NULL;
+        payload = cerdeb_unpack_u32(payload, &count);
+        if ((size_t)(end - payload) / kind_sizes[f.kind] < count) return NULL;
+
+        *p++ = '[';
+        for (size_t j = 0; j < CERDEB_ARRAY_SHOWN(count); ++j) {
+            if (j != 0) p = cerdeb_write_lit(p, ", ", 2);
+            p = render_value(p, f, &payload, end);
+        }
+        payload += (count - CERDEB_ARRAY_SHOWN(count)) * kind_sizes[f.kind];
+        p = cerdeb_write_array_end(p, count);
+    }
+
+    *payload_at = payload;
+    return cerdeb_write_lit(p, " }", 2);
+}
+
+// appends the text of one record followed by a new line to `out`
+void render_record(String_Builder* out, uint32_t type_id, const char* payload, uint32_t size) {
+    Meta_Type* type = find_type(type_id);
+    if (type == NULL) {
+        sb_appendf(out, "<unknown record 0x%08x of %u bytes>\n", type_id, size);
+        return;
+    }
+
+    // the strings can't print more than the payload
+    da_reserve(out, out->count + type->max_len + size + 1);
+    char* p = render_fields(out->items + out->count, type, &payload, payload + size);
+    if (p == NULL) {
+        sb_appendf(out, "<malformed %s record of %u bytes>\n", type->name, size);
+        return;
+    }
+
+    *p++ = '\n';
+    out->count = p - out->items;
+}
+
+typedef struct {
+    const char* begin;
+    const char* end;
+    String_Builder out;
+} Chunk;
+
+void* decode_chunk(void* arg) {
+    Chunk* chunk = arg;
+    chunk->out.count = 0;
+
+    for (const char* p = chunk->begin; p < chunk->end; ) {
+        uint32_t type_id, size;
+        memcpy(&type_id, p, 4);
+        memcpy(&size, p + 4, 4);
+        render_record(&chunk->out, type_id, p + CERDEB_LOG_HEADER_SIZE, size);
+        p += CERDEB_LOG_HEADER_SIZE + size;
+    }
+
+    return NULL;
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+// Every round splits the next `threads` * DECODE_CHUNK bytes of the log at
+// record boundaries, decodes the chunks in parallel and writes them in order
+bool decode_log(const char* data, size_t size, size_t threads) {
+    Chunk* chunks = calloc(threads, sizeof(*chunks));
+    pthread_t* workers = calloc(threads, sizeof(*workers));
+
+    const char* p = data;
+    const char* end = data + size;
+    while (p < end) {
+        size_t count = 0;
+        for (; count < threads && p < end; ++count) {
+            const char* target = (size_t)(end - p) > DECODE_CHUNK ? p + DECODE_CHUNK : end;
+            chunks[count].begin = p;
+
+            // only the headers are read to find the boundaries
+            while (p < target) {
+                uint32_t record_size;
+                if ((size_t)(end - p) < CERDEB_LOG_HEADER_SIZE) break;
+                memcpy(&record_size, p + 4, 4);
+                if ((size_t)(end - p) - CERDEB_LOG_HEADER_SIZE < record_size) break;
+                p += CERDEB_LOG_HEADER_SIZE + record_size;
+            }
+
+            chunks[count].end = p;
+            if (p < target) {
+                nob_log(WARNING, "truncated record at offset %zu", (size_t)(p - data));
+                end = p;
+            }
+        }
+
+        for (size_t i = 1; i < count; ++i) pthread_create(&workers[i], NULL, decode_chunk, &chunks[i]);
+        decode_chunk(&chunks[0]);
+        for (size_t i = 1; i < count; ++i) pthread_join(workers[i], NULL);
+
+        for (size_t i = 0; i < count; ++i) {
+            if (!write_all(STDOUT_FILENO, chunks[i].out.items, chunks[i].out.count)) return false;
+        }
+    }
+
+    for (size_t i = 0; i < threads; ++i) sb_free(chunks[i].out);
+    free(chunks);
+    free(workers);
+    return true;
+}
+
+typedef struct {
+    uint64_t seq;
+    const char* slot;
+} Snapshot;
+
+int compare_snapshots(const void* a, const void* b) {
+    uint64_t x = ((const Snapshot*)a)->seq;
+    uint64_t y = ((const Snapshot*)b)->seq;
+    return (x > y) - (x < y);
+}
+
+// prints the snapshots left in a flight recorder file from the oldest to the newest
+bool decode_flight(const char* data, size_t size) {
+    uint32_t slot_size, slots;
+    memcpy(&slot_size, data + 8, 4);
+    memcpy(&slots, data + 12, 4);
+
+    if (slot_size <= CERDEB_FLIGHT_SLOT_HEADER || (size - CERDEB_FLIGHT_HEADER_SIZE) / slot_size < slots) {
+        nob_log(ERROR, "corrupted flight recorder header");
+        return false;
+    }
+
+    Snapshot* snapshots = calloc(slots, sizeof(*snapshots));
+    size_t count = 0;
+    for (size_t i = 0; i < slots; ++i) {
+        const char* slot = data + CERDEB_FLIGHT_HEADER_SIZE + i * slot_size;
+        uint64_t seq;
+        memcpy(&seq, slot, 8);
+        // 0 is an empty slot or one that was being written during the crash
+        if (seq != 0) snapshots[count++] = (Snapshot){ seq, slot };
+    }
+    qsort(snapshots, count, sizeof(*snapshots), compare_snapshots);
+
+    String_Builder out = {0};
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t type_id, record_size;
+        memcpy(&type_id, snapshots[i].slot + 8, 4);
+        memcpy(&record_size, snapshots[i].slot + 12, 4);
+        if (record_size > slot_size - CERDEB_FLIGHT_SLOT_HEADER) continue;
+        render_record(&out, type_id, snapshots[i].slot + CERDEB_FLIGHT_SLOT_HEADER, record_size);
+    }
+
+    bool ok = write_all(STDOUT_FILENO, out.items, out.count);
+    sb_free(out);
+    free(snapshots);
+    return ok;
+}
+
+void usage(const char* program) {
+    fprintf(stderr, "Usage: %s <cerdeb.meta> <log or flight recorder> [-j threads]\n", program);
+}
+
+int main(int argc, char** argv) {
+    const char* program = shift(argv, argc);
+    if (argc < 2) {
+        usage(program);
+        return 1;
+    }
+
+    const char* meta_path = shift(argv, argc);
+    const char* log_path = shift(argv, argc);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = cpus > 0 ? (size_t)cpus : 1;
+    if (argc >= 2 && strcmp(argv[0], "-j") == 0) threads = strtoul(argv[1], NULL, 10);
+    if (threads == 0) threads = 1;
+
+    if (!parse_meta(meta_path)) return 1;
+
+    int fd = open(log_path, O_RDONLY);
+    if (fd < 0) {
+        nob_log(ERROR, "could not open %s: %s", log_path, strerror(errno));
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) return 1;
+    size_t size = st.st_size;
+    size_t magic = strlen(CERDEB_LOG_MAGIC);
+
+    const char* data = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    if (size > 0 && data == MAP_FAILED) {
+        nob_log(ERROR, "could not map %s: %s", log_path, strerror(errno));
+        return 1;
+    }
+
+    if (size >= CERDEB_FLIGHT_HEADER_SIZE && memcmp(data, CERDEB_FLIGHT_MAGIC, magic) == 0) {
+        if (!decode_flight(data, size)) return 1;
+    } else if (size >= magic && memcmp(data, CERDEB_LOG_MAGIC, magic) == 0) {
+        madvise((void*)data, size, MADV_SEQUENTIAL);
+        if (!decode_log(data + magic, size - magic, threads)) return 1;
+    } else {
+        nob_log(ERROR, "%s is not a cerdeb log", log_path);
+        return 1;
+    }
+
+    munmap((void*)data, size);
+    close(fd);
+    return 0;
+}
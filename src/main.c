@@ -8,6 +8,7 @@
 #include "../extern/stb_c_lexer.h"
 
 #define BUILD_DIR "./output/"
+#define RUNTIME_HEADER "./src/cerdeb.h"
 
 static void print_token(stb_lexer *lexer) {
    switch (lexer->token) {
@@ -62,12 +63,23 @@ typedef enum {
     DOUBLE,
     STRING,
     POINTER,
-    CHAR
+    CHAR,
+    FLOAT,
+    NESTED, // another derived struct
+    UNSIGNED,
+    LONGUNSIGNED,
+    ENUM, // a derived enum, printed by name
 } FormatType;
 
 typedef struct {
     const char* field_name;
     FormatType ft;
+    const char* type_name; // of NESTED and ENUM fields
+    const char* array_len; // of `name[N]` fields, N can be a macro
+    bool follow; // pointer to a derived struct, printed in place
+    bool hex; // !hex
+    const char* len_field; // !len(field), the length of a string
+    const char* max; // !max(N), N can be a macro
 } Field;
 
 typedef struct {
@@ -80,7 +92,13 @@ typedef struct {
     size_t pos_print;
     size_t pos_comment;
     const char* name;
+    const char* tag; // of `typedef struct Tag {`
     Fields fields;
+    bool log; // derived with !log
+    bool follow; // derived with !follow
+    bool cache; // derived with !cache
+    bool header; // defined in a .h file
+    size_t slot; // position in cerdeb_debug, unique in the build
 } Struct;
 
 typedef struct {
@@ -89,10 +107,76 @@ typedef struct {
     size_t capacity;
 } Structs;
 
+typedef struct {
+    const char* name;
+    int64_t value;
+    bool known; // evaluated by cerdeb, the values using macros, sizeof or casts are left to the compiler
+    bool alias; // has the known value of an earlier constant, which gives the name
+} Constant;
+
+typedef struct {
+    Constant* items;
+    size_t count;
+    size_t capacity;
+} Constants;
+
+typedef struct {
+    size_t pos_print;
+    size_t pos_comment;
+    const char* name;
+    const char* tag; // of `typedef enum Tag {`
+    Constants constants;
+} Enum;
+
+typedef struct {
+    Enum* items;
+    size_t count;
+    size_t capacity;
+} Enums;
+
 #define BUF_LEN 1 << 10
 stb_lexer lex = {0};
 char string_store[BUF_LEN];
 Structs structs = {0};
+Enums enums = {0};
+Enums known_enums = {0}; // of every file, found before the structs are parsed
+Structs known_structs = {0}; // names and tags of the derived structs of every file, found with the enums
+String_Builder log_meta = {0};
+bool gc_sections = false;
+size_t slot_count = 0;
+
+bool is_signed(FormatType ft) {
+    return ft == DECIMAL || ft == LONGDECIMAL;
+}
+
+bool is_integer(FormatType ft) {
+    return is_signed(ft) || ft == UNSIGNED || ft == LONGUNSIGNED;
+}
+
+// 32 bits wide
+bool is_narrow(FormatType ft) {
+    return ft == DECIMAL || ft == UNSIGNED;
+}
+
+// char[N] is printed like a string
+bool is_chars(Field f) {
+    return f.array_len && f.ft == CHAR;
+}
+
+// the other arrays element by element
+bool is_array(Field f) {
+    return f.array_len && f.ft != CHAR;
+}
+
+// signed integer fields that the batch printers format column by column
+bool is_column(Field f) {
+    return is_signed(f.ft) && f.array_len == NULL && !f.hex;
+}
+
+// strings printed with an explicit length instead of strlen
+bool is_strn(Field f) {
+    return f.ft == STRING && (f.len_field || f.max);
+}
 
 bool expect_id_name(char* id) {
     if (lex.token != CLEX_id || strcmp(lex.string, id) != 0) return false;
@@ -106,54 +190,242 @@ bool expect_char(char ch) {
     return true;
 }
 
-FormatType parse_type() {
+// any other type name is taken for a derived struct, parse_struct tells the
+// derived enums from them and rejects the names that are neither
+FormatType parse_type(const char** type_name) {
     if (lex.token != CLEX_id) return BOGUS;
     if (strcmp(lex.string, "const") == 0) stb_c_lexer_get_token(&lex);
+    if (lex.token != CLEX_id) return BOGUS;
+    if (strcmp(lex.string, "struct") == 0 || strcmp(lex.string, "enum") == 0) stb_c_lexer_get_token(&lex);
+    if (lex.token != CLEX_id) return BOGUS;
+
+    // `unsigned` and `signed` alone are ints
+    bool is_unsigned = expect_id_name("unsigned");
+    bool has_sign = is_unsigned || expect_id_name("signed");
 
-    // TODO: support unsigned and signed
     static const char* types[] = {
-        "int", "short", "long", "float", "double", "char"
+        "int", "short", "long", "float", "double", "char",
+        "int8_t", "int16_t", "int32_t", "int64_t", "ssize_t", "ptrdiff_t", "intptr_t",
+        "uint8_t", "uint16_t", "uint32_t", "uint64_t", "size_t", "uintptr_t"
     };
 
     static const FormatType ftypes[] = {
-        DECIMAL, DECIMAL, LONGDECIMAL, DOUBLE, DOUBLE, CHAR
+        DECIMAL, DECIMAL, LONGDECIMAL, FLOAT, DOUBLE, CHAR,
+        DECIMAL, DECIMAL, DECIMAL, LONGDECIMAL, LONGDECIMAL, LONGDECIMAL, LONGDECIMAL,
+        UNSIGNED, UNSIGNED, UNSIGNED, LONGUNSIGNED, LONGUNSIGNED, LONGUNSIGNED
     };
 
     size_t i = 0;
-    for (; i < ARRAY_LEN(types); ++i) {
+    for (; lex.token == CLEX_id && i < ARRAY_LEN(types); ++i) {
         if (strcmp(lex.string, types[i]) == 0) break;
     }
 
-    if (i == ARRAY_LEN(types)) return BOGUS;
-    stb_c_lexer_get_token(&lex);
+    FormatType ft = DECIMAL;
+    if (lex.token == CLEX_id && i < ARRAY_LEN(types)) {
+        ft = ftypes[i];
+        stb_c_lexer_get_token(&lex);
+        // `long long`, `long int`, `short int`
+        if (i < 3) {
+            while (expect_id_name("long") || expect_id_name("int")) {}
+        }
+    } else if (!has_sign) {
+        if (lex.token != CLEX_id) return BOGUS;
+        ft = NESTED;
+        *type_name = strdup(lex.string);
+        stb_c_lexer_get_token(&lex);
+    }
+
+    // unsigned chars are bytes rather than characters
+    if (is_unsigned && (ft == DECIMAL || ft == CHAR)) ft = UNSIGNED;
+    if (is_unsigned && ft == LONGDECIMAL) ft = LONGUNSIGNED;
 
     if (expect_char('*')) {
-        if (ftypes[i] == CHAR) return STRING;
+        if (ft == CHAR) return STRING;
         return POINTER;
     } 
 
-    return ftypes[i];
+    return ft;
+}
+
+// the name in `!len(name)` or the number or macro in `!max(N)`
+const char* parse_attribute_arg(void) {
+    if (!expect_char('(')) return NULL;
+
+    const char* arg = NULL;
+    if (lex.token == CLEX_intlit) {
+        arg = strdup(temp_sprintf("%ld", lex.int_number));
+    } else if (lex.token == CLEX_id) {
+        arg = strdup(lex.string);
+    } else {
+        return NULL;
+    }
+    stb_c_lexer_get_token(&lex);
+
+    if (!expect_char(')')) return NULL;
+    return arg;
+}
+
+// `!skip`, `!hex`, `!len(field)` and `!max(N)` come before the type of a
+// field, they are blanked out of the generated source
+bool parse_attributes(Field* field, bool* skip) {
+    char* start = lex.where_firstchar;
+    bool attributes = false;
+
+    while (lex.token == '!') {
+        attributes = true;
+        stb_c_lexer_get_token(&lex);
+        if (expect_id_name("skip")) {
+            *skip = true;
+        } else if (expect_id_name("hex")) {
+            field->hex = true;
+        } else if (expect_id_name("len")) {
+            field->len_field = parse_attribute_arg();
+            if (field->len_field == NULL) return false;
+        } else if (expect_id_name("max")) {
+            field->max = parse_attribute_arg();
+            if (field->max == NULL) return false;
+        } else {
+            nob_log(ERROR, "unknown field attribute !%s", lex.token == CLEX_id ? lex.string : "");
+            return false;
+        }
+    }
+
+    // same length, the positions of the generated code don't move
+    if (attributes) {
+        for (char* c = start; c < lex.where_firstchar; ++c) {
+            if (*c != '\n') *c = ' ';
+        }
+    }
+    return true;
+}
+
+// the attributes only apply where they make sense
+bool check_attributes(Field f) {
+    if (f.hex && !is_integer(f.ft)) {
+        nob_log(ERROR, "%s: !hex only applies to integers", f.field_name);
+        return false;
+    }
+    if (f.len_field && (f.ft != STRING || f.array_len)) {
+        nob_log(ERROR, "%s: !len only applies to char* fields", f.field_name);
+        return false;
+    }
+    if (f.max && f.ft != STRING && !is_chars(f)) {
+        nob_log(ERROR, "%s: !max only applies to strings", f.field_name);
+        return false;
+    }
+    if (f.max && f.array_len && f.ft == STRING) {
+        nob_log(ERROR, "%s: !max doesn't apply to arrays of strings", f.field_name);
+        return false;
+    }
+    return true;
 }
 
 bool parse_field(Struct* str) {
-    FormatType ft = parse_type();
+    Field field = {0};
+    bool skip = false;
+    if (!parse_attributes(&field, &skip)) return false;
+
+    const char* type_name = NULL;
+    FormatType ft = parse_type(&type_name);
     if (ft == BOGUS) return false;
 
     if (lex.token != CLEX_id) return false;
 
-    Field field = { .ft = ft, .field_name = strdup(lex.string) };
-    da_append(&str->fields, field);
-
+    field.ft = ft;
+    field.field_name = strdup(lex.string);
+    field.type_name = type_name;
     stb_c_lexer_get_token(&lex);
+
+    if (expect_char('[')) {
+        if (lex.token == CLEX_intlit) {
+            field.array_len = strdup(temp_sprintf("%ld", lex.int_number));
+        } else if (lex.token == CLEX_id) {
+            field.array_len = strdup(lex.string);
+        } else {
+            return false;
+        }
+        stb_c_lexer_get_token(&lex);
+        if (!expect_char(']')) return false;
+    }
+
+    if (!check_attributes(field)) return false;
+    if (!skip) da_append(&str->fields, field);
     if (!expect_char(';')) return false;
     return true;
 }
 
-bool parse_struct(size_t pos_comment) {
-    Struct str = {0};
+// `!debug`, `!log`, `!follow` and `!cache` can be combined, the others imply `!debug`
+bool parse_derives(Struct* str) {
+    bool derived = false;
+    while (lex.token == '!') {
+        stb_c_lexer_get_token(&lex);
+        if (expect_id_name("debug")) {
+            derived = true;
+        } else if (expect_id_name("log")) {
+            derived = true;
+            str->log = true;
+        } else if (expect_id_name("follow")) {
+            derived = true;
+            str->follow = true;
+        } else if (expect_id_name("cache")) {
+            derived = true;
+            str->cache = true;
+        } else {
+            return derived;
+        }
+    }
+    return derived;
+}
+
+// the enum of a field, by its name or its tag
+const Enum* find_enum(const char* type_name) {
+    for (size_t i = 0; i < known_enums.count; ++i) {
+        const Enum* e = &known_enums.items[i];
+        if (strcmp(e->name, type_name) == 0) return e;
+        if (e->tag && strcmp(e->tag, type_name) == 0) return e;
+    }
+    return NULL;
+}
+
+// the derived struct of a field, by its name or its tag
+const Struct* find_struct(const char* type_name) {
+    for (size_t i = 0; i < known_structs.count; ++i) {
+        const Struct* s = &known_structs.items[i];
+        if (strcmp(s->name, type_name) == 0) return s;
+        if (s->tag && strcmp(s->tag, type_name) == 0) return s;
+    }
+    return NULL;
+}
+
+// only the name and the tag of a derived struct are needed before the fields
+// are parsed, the fields are skipped
+bool parse_struct_name(Struct str) {
+    if (!expect_id_name("struct")) return false;
+    if (lex.token == CLEX_id) {
+        str.tag = strdup(lex.string);
+        stb_c_lexer_get_token(&lex);
+    }
+    if (!expect_char('{')) return false;
+
+    for (size_t depth = 1; depth > 0; ) {
+        if (lex.token == '{') ++depth;
+        if (lex.token == '}') --depth;
+        if (!stb_c_lexer_get_token(&lex)) return false;
+    }
 
-    if (!expect_id_name("typedef")) return false;
+    if (lex.token != CLEX_id) return false;
+    str.name = strdup(lex.string);
+    stb_c_lexer_get_token(&lex);
+    da_append(&known_structs, str);
+    return true;
+}
+
+bool parse_struct(Struct str, size_t pos_comment) {
     if (!expect_id_name("struct")) return false;
+    if (lex.token == CLEX_id) {
+        str.tag = strdup(lex.string);
+        stb_c_lexer_get_token(&lex);
+    }
     if (!expect_char('{')) return false;
 
     while (!expect_char('}')) {
@@ -164,6 +436,81 @@ bool parse_struct(size_t pos_comment) {
     str.name = strdup(lex.string);
     stb_c_lexer_get_token(&lex);
 
+    // `struct Tag*` fields point to the typedef of the tag. Only the pointers
+    // to derived structs are followed, the others (`FILE*`, `struct
+    // sockaddr*`, ...) have no printer and keep their address
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        Field* f = &str.fields.items[i];
+        if (f->type_name == NULL) continue;
+        const Struct* s = find_struct(f->type_name);
+        if (s) f->type_name = s->name;
+        const Enum* e = find_enum(f->type_name);
+        if (e) {
+            f->type_name = e->name;
+            if (f->ft == NESTED) f->ft = ENUM;
+        }
+        f->follow = str.follow && f->ft == POINTER && s != NULL;
+
+        // `bool` or a typedef cerdeb doesn't see would only fail once the
+        // generated code is compiled, on a printer that doesn't exist
+        if (f->ft == NESTED && s == NULL) {
+            nob_log(ERROR, "%s.%s: %s is neither a derived struct nor a derived enum, derive it or !skip the field",
+                    str.name, f->field_name, f->type_name);
+            return false;
+        }
+        // the nested struct is packed by its own Name_log_pack
+        if (str.log && f->ft == NESTED && !s->log) {
+            nob_log(ERROR, "%s.%s: %s has to be derived with !log too", str.name, f->field_name, f->type_name);
+            return false;
+        }
+    }
+
+    // `char* name` right before a `size_t name_len`, `name_size`, `len` or
+    // `size` is taken for a string and its length, like `!len` does
+    for (size_t i = 0; i + 1 < str.fields.count; ++i) {
+        Field* f = &str.fields.items[i];
+        Field g = str.fields.items[i + 1];
+        if (f->ft != STRING || f->array_len || f->len_field) continue;
+        if ((g.ft != UNSIGNED && g.ft != LONGUNSIGNED) || g.array_len) continue;
+        if (strcmp(g.field_name, "len") == 0 || strcmp(g.field_name, "size") == 0 ||
+            strcmp(g.field_name, temp_sprintf("%s_len", f->field_name)) == 0 ||
+            strcmp(g.field_name, temp_sprintf("%s_size", f->field_name)) == 0) {
+            f->len_field = g.field_name;
+        }
+    }
+
+    // the hash only covers the struct and its strings
+    for (size_t i = 0; str.cache && i < str.fields.count; ++i) {
+        if (str.fields.items[i].follow) {
+            nob_log(ERROR, "%s.%s: followed pointers can't be derived with !cache", str.name, str.fields.items[i].field_name);
+            return false;
+        }
+    }
+
+    // the length of a `!len` string is logged and printed with it
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        Field f = str.fields.items[i];
+        if (f.len_field == NULL) continue;
+        size_t j = 0;
+        for (; j < str.fields.count; ++j) {
+            Field g = str.fields.items[j];
+            if (strcmp(g.field_name, f.len_field) == 0 && is_integer(g.ft) && g.array_len == NULL) break;
+        }
+        if (j == str.fields.count) {
+            nob_log(ERROR, "%s.%s: !len(%s) needs an integer field %s that isn't skipped", str.name, f.field_name, f.len_field, f.len_field);
+            return false;
+        }
+    }
+
+    // the records only have room for arrays of fixed-size elements
+    for (size_t i = 0; str.log && i < str.fields.count; ++i) {
+        Field f = str.fields.items[i];
+        if (is_array(f) && (f.ft == STRING || f.ft == NESTED)) {
+            nob_log(ERROR, "%s.%s: arrays of strings and structs can't be derived with !log", str.name, f.field_name);
+            return false;
+        }
+    }
+
     size_t pos = lex.where_firstchar - lex.input_stream + 1;
     if (!expect_char(';')) return false;
 
@@ -173,32 +520,1069 @@ bool parse_struct(size_t pos_comment) {
     return true;
 }
 
-String_Builder construct_debug_print(Struct str) {
-    String_Builder sb = {0};
+int64_t parse_enum_expr(const Enum* e, int min_prec, bool* known);
 
-    static const char* formats[] = {
-        NULL, "%d", "%ld", "%f", "%s", "%p", "%c"
-    };
-    
-    // TODO: dont use nob as a dependecy for using this constructed function
-    sb_appendf(&sb, "char* %s_debug_print(%s *str) {\n", str.name, str.name);
-    sb_appendf(&sb, "    return temp_sprintf(\"%s {", str.name);
+// literals, earlier constants, unary operators and parentheses, anything else
+// is left for the caller to skip
+int64_t parse_enum_operand(const Enum* e, bool* known) {
+    if (expect_char('(')) {
+        int64_t v = parse_enum_expr(e, 0, known);
+        if (!expect_char(')')) *known = false;
+        return v;
+    }
+    if (expect_char('-')) return (int64_t)(0 - (uint64_t)parse_enum_operand(e, known));
+    if (expect_char('+')) return parse_enum_operand(e, known);
+    if (expect_char('~')) return ~parse_enum_operand(e, known);
+
+    if (lex.token == CLEX_intlit || lex.token == CLEX_charlit) {
+        int64_t v = lex.int_number;
+        stb_c_lexer_get_token(&lex);
+        return v;
+    }
+    for (size_t i = 0; lex.token == CLEX_id && i < e->constants.count; ++i) {
+        Constant c = e->constants.items[i];
+        if (strcmp(c.name, lex.string) != 0) continue;
+        *known = *known && c.known;
+        stb_c_lexer_get_token(&lex);
+        return c.value;
+    }
+
+    *known = false;
+    return 0;
+}
+
+int binary_prec(long token) {
+    switch (token) {
+        case '|': return 1;
+        case '^': return 2;
+        case '&': return 3;
+        case CLEX_shl: case CLEX_shr: return 4;
+        case '+': case '-': return 5;
+        case '*': case '/': case '%': return 6;
+        default: return 0;
+    }
+}
+
+// the integer constant expressions of enums, like `1 << 4` or `COUNT - 1`
+int64_t parse_enum_expr(const Enum* e, int min_prec, bool* known) {
+    int64_t a = parse_enum_operand(e, known);
+    while (*known && binary_prec(lex.token) > min_prec) {
+        long op = lex.token;
+        stb_c_lexer_get_token(&lex);
+        int64_t b = parse_enum_expr(e, binary_prec(op), known);
+        uint64_t x = (uint64_t)a, y = (uint64_t)b;
+
+        switch (op) {
+            case '|': a = (int64_t)(x | y); break;
+            case '^': a = (int64_t)(x ^ y); break;
+            case '&': a = (int64_t)(x & y); break;
+            case '+': a = (int64_t)(x + y); break;
+            case '-': a = (int64_t)(x - y); break;
+            case '*': a = (int64_t)(x * y); break;
+            case CLEX_shl: *known = *known && y < 64; a = *known ? (int64_t)(x << y) : 0; break;
+            case CLEX_shr: *known = *known && y < 64; a = *known ? a >> y : 0; break;
+            default:
+                // division by zero and INT64_MIN / -1 are left to the compiler
+                *known = *known && b != 0 && !(a == INT64_MIN && b == -1);
+                if (*known) a = op == '/' ? a / b : a % b;
+        }
+    }
+    return a;
+}
+
+// the value of a constant is evaluated like the compiler does, the ones using
+// macros, sizeof or casts stay unknown
+bool parse_constant(Enum* e) {
+    if (lex.token != CLEX_id) return false;
+    Constant c = { .name = strdup(lex.string), .known = true };
+    stb_c_lexer_get_token(&lex);
+
+    if (e->constants.count > 0) {
+        Constant prev = da_last(&e->constants);
+        c.value = (int64_t)((uint64_t)prev.value + 1);
+        c.known = prev.known;
+    }
+
+    if (expect_char('=')) {
+        c.known = true;
+        c.value = parse_enum_expr(e, 0, &c.known);
+
+        // whatever the evaluation stopped at
+        size_t depth = 0;
+        while (depth > 0 || (lex.token != ',' && lex.token != '}')) {
+            if (lex.token == CLEX_eof || lex.token == CLEX_parse_error) return false;
+            if (lex.token == '(') ++depth;
+            if (lex.token == ')' && depth > 0) --depth;
+            c.known = false;
+            stb_c_lexer_get_token(&lex);
+        }
+    }
+
+    // the first constant of a value gives its name
+    for (size_t i = 0; c.known && i < e->constants.count; ++i) {
+        Constant other = e->constants.items[i];
+        if (other.known && other.value == c.value) c.alias = true;
+    }
+
+    da_append(&e->constants, c);
+    return lex.token == '}' || expect_char(',');
+}
+
+bool parse_enum(Struct derives, size_t pos_comment, Enums* dest) {
+    Enum e = { .pos_comment = pos_comment };
+    if (lex.token == CLEX_id) {
+        e.tag = strdup(lex.string);
+        stb_c_lexer_get_token(&lex);
+    }
+    if (!expect_char('{')) return false;
+
+    while (!expect_char('}')) {
+        if (!parse_constant(&e)) return false;
+    }
+
+    if (lex.token != CLEX_id) return false;
+    e.name = strdup(lex.string);
+    stb_c_lexer_get_token(&lex);
+
+    if (derives.log || derives.follow || derives.cache) {
+        nob_log(ERROR, "%s: enums only derive !debug, the structs using them are logged", e.name);
+        return false;
+    }
+
+    size_t pos = lex.where_firstchar - lex.input_stream + 1;
+    if (!expect_char(';')) return false;
+
+    e.pos_print = pos;
+    da_append(dest, e);
+    return true;
+}
+
+// NESTED and ENUM fields go through the functions generated for their type
+static const char* writers[] = {
+    NULL, "cerdeb_write_i32", "cerdeb_write_i64", "cerdeb_write_f64",
+    "cerdeb_write_str", "cerdeb_write_ptr", "cerdeb_write_char",
+    "cerdeb_write_f32", NULL, "cerdeb_write_u64", "cerdeb_write_u64", NULL
+};
+
+// upper bound of the formatted field, strings also add their length
+// NOTE: has to match the CERDEB_*_MAX_LEN constants of cerdeb.h
+static const size_t max_lens[] = {
+    0, 11, 20, 25, 0, 18, 1, 24, 0, 10, 20, 0
+};
+
+// `!hex` integers, see CERDEB_HEX*_MAX_LEN
+size_t scalar_max_len(Field f) {
+    if (f.hex) return is_narrow(f.ft) ? 10 : 18;
+    return max_lens[f.ft];
+}
+
+// the characters of a `!len` or `!max` string of the struct at `owner` that are printed
+const char* strn_len(Field f, const char* owner) {
+    if (f.len_field == NULL) return temp_sprintf("cerdeb_str_len_max(%s->%s, %s)", owner, f.field_name, f.max);
+    const char* len = temp_sprintf("(size_t)%s->%s", owner, f.len_field);
+    if (f.max == NULL) return len;
+    return temp_sprintf("(%s < (size_t)(%s) ? %s : (size_t)(%s))", len, f.max, len, f.max);
+}
+
+// the room of a char[N], `!max` may cut it further
+const char* chars_len(Field f) {
+    if (f.max == NULL) return f.array_len;
+    return temp_sprintf("((%s) < (%s) ? (%s) : (%s))", f.array_len, f.max, f.array_len, f.max);
+}
+
+const char* upper_name(const char* name) {
+    char* upper = temp_strdup(name);
+    for (char* c = upper; *c; ++c) *c = toupper(*c);
+    return upper;
+}
+
+typedef enum {
+    WRITE_PLAIN,
+    WRITE_COLUMNS,     // integers come from the `col_*` columns
+    WRITE_SIGNAL_SAFE, // strings go straight to `fd`, the rest through the small `buf`
+} WriteMode;
+
+void flush_literal(String_Builder* sb, String_Builder* lit, const char* indent, WriteMode mode) {
+    if (lit->count == 0) return;
+    if (mode == WRITE_SIGNAL_SAFE) {
+        sb_appendf(sb, "%sp = cerdeb_write_lit_fd(fd, buf, p, \"%.*s\", %zu);\n", indent, (int)lit->count, lit->items, lit->count);
+    } else {
+        sb_appendf(sb, "%sp = cerdeb_write_lit(p, \"%.*s\", %zu);\n", indent, (int)lit->count, lit->items, lit->count);
+    }
+    lit->count = 0;
+}
+
+// flushes the signal-safe `buf` unless the value of `f` fits, strings and
+// nested structs take care of themselves
+void construct_signal_safe_room(String_Builder* sb, Field f, const char* indent) {
+    if (is_strn(f) || f.ft == STRING || f.ft == NESTED) return;
+    if (f.ft == ENUM) {
+        const char* len = temp_sprintf("%s_DEBUG_MAX_LEN", upper_name(f.type_name));
+        sb_appendf(sb, "%s_Static_assert(%s <= CERDEB_SIGNAL_SAFE_BUF, \"the names of %s have to fit CERDEB_SIGNAL_SAFE_BUF\");\n",
+                   indent, len, f.type_name);
+        sb_appendf(sb, "%sp = cerdeb_room_fd(fd, buf, p, %s);\n", indent, len);
+    } else {
+        sb_appendf(sb, "%sp = cerdeb_room_fd(fd, buf, p, %zu);\n", indent, scalar_max_len(f));
+    }
+}
+
+// formats one `value` of the type of `f`, a field or an element of an array
+void construct_debug_value(String_Builder* sb, Field f, const char* value, const char* indent, WriteMode mode) {
+    if (mode == WRITE_SIGNAL_SAFE) construct_signal_safe_room(sb, f, indent);
+    if (mode == WRITE_SIGNAL_SAFE && is_strn(f)) {
+        sb_appendf(sb, "%sp = cerdeb_flush_fd(fd, buf, p);\n", indent);
+        sb_appendf(sb, "%scerdeb_write_strn_fd(fd, %s, %s);\n", indent, value, strn_len(f, "str"));
+    } else if (is_strn(f)) {
+        // the ones with a `!max` fit in the static bound
+        sb_appendf(sb, "%sp = cerdeb_write_strn(p, %s, %s);\n", indent, value, strn_len(f, "str"));
+    } else if (f.hex) {
+        sb_appendf(sb, "%sp = cerdeb_write_hex(p, (%s)%s);\n", indent, is_narrow(f.ft) ? "uint32_t" : "uint64_t", value);
+    } else if (mode == WRITE_SIGNAL_SAFE && f.ft == STRING) {
+        sb_appendf(sb, "%sp = cerdeb_flush_fd(fd, buf, p);\n", indent);
+        sb_appendf(sb, "%scerdeb_write_str_fd(fd, %s);\n", indent, value);
+    } else if (mode == WRITE_SIGNAL_SAFE && f.ft == NESTED) {
+        sb_appendf(sb, "%sp = %s_debug_write_fd(fd, buf, p, &%s);\n", indent, f.type_name, value);
+    } else if (f.ft == NESTED) {
+        sb_appendf(sb, "%sp = %s_debug_write(p, &%s);\n", indent, f.type_name, value);
+    } else if (f.ft == ENUM) {
+        sb_appendf(sb, "%sp = %s_debug_write(p, %s);\n", indent, f.type_name, value);
+    } else if (mode != WRITE_SIGNAL_SAFE && f.follow) {
+        sb_appendf(sb, "%s{\n", indent);
+        sb_appendf(sb, "%s    Cerdeb_Follow_Step step = cerdeb_follow_enter(str, %s);\n", indent, value);
+        sb_appendf(sb, "%s    p = cerdeb_write_follow(p, %s, step);\n", indent, value);
+        sb_appendf(sb, "%s    if (step == CERDEB_FOLLOW_GO) {\n", indent);
+        sb_appendf(sb, "%s        p = %s_debug_write(p, %s);\n", indent, f.type_name, value);
+        sb_appendf(sb, "%s        cerdeb_follow_leave();\n", indent);
+        sb_appendf(sb, "%s    }\n", indent);
+        sb_appendf(sb, "%s}\n", indent);
+    } else {
+        sb_appendf(sb, "%sp = %s(p, %s);\n", indent, writers[f.ft], value);
+    }
+}
+
+// formats the field `f` of `str` at `p`, arrays after their "["
+void construct_debug_field(String_Builder* sb, Field f, const char* indent, WriteMode mode) {
+    const char* value = temp_sprintf("str->%s", f.field_name);
+    if (mode == WRITE_COLUMNS && is_column(f)) {
+        sb_appendf(sb, "%sp = cerdeb_write_column(p, &col_%s, i);\n", indent, f.field_name);
+    } else if (mode == WRITE_SIGNAL_SAFE && is_chars(f)) {
+        sb_appendf(sb, "%sp = cerdeb_flush_fd(fd, buf, p);\n", indent);
+        sb_appendf(sb, "%scerdeb_write_strn_fd(fd, %s, cerdeb_chars_len(%s, %s));\n", indent, value, value, chars_len(f));
+    } else if (is_chars(f)) {
+        sb_appendf(sb, "%sp = cerdeb_write_chars(p, %s, %s);\n", indent, value, chars_len(f));
+    } else if (mode != WRITE_SIGNAL_SAFE && is_array(f) && is_signed(f.ft) && !f.hex) {
+        sb_appendf(sb, "%sp = cerdeb_write_int_array(p, %s, sizeof(%s[0]), CERDEB_ARRAY_SHOWN(%s));\n", indent, value, value, f.array_len);
+        sb_appendf(sb, "%sp = cerdeb_write_array_end(p, %s);\n", indent, f.array_len);
+    } else if (is_array(f)) {
+        const char* inner = temp_sprintf("%s    ", indent);
+        sb_appendf(sb, "%sfor (size_t j = 0; j < CERDEB_ARRAY_SHOWN(%s); ++j) {\n", indent, f.array_len);
+        if (mode == WRITE_SIGNAL_SAFE) {
+            sb_appendf(sb, "%sif (j != 0) p = cerdeb_write_lit_fd(fd, buf, p, \", \", 2);\n", inner);
+        } else {
+            sb_appendf(sb, "%sif (j != 0) p = cerdeb_write_lit(p, \", \", 2);\n", inner);
+        }
+        construct_debug_value(sb, f, temp_sprintf("%s[j]", value), inner, mode);
+        sb_appendf(sb, "%s}\n", indent);
+        if (mode == WRITE_SIGNAL_SAFE) sb_appendf(sb, "%sp = cerdeb_room_fd(fd, buf, p, sizeof(\", ...]\") - 1);\n", indent);
+        sb_appendf(sb, "%sp = cerdeb_write_array_end(p, %s);\n", indent, f.array_len);
+    } else {
+        construct_debug_value(sb, f, value, indent, mode);
+    }
+}
+
+// formats `str` at `p`
+void construct_debug_fields(String_Builder* sb, Struct str, const char* indent, WriteMode mode) {
+    String_Builder lit = {0};
+    sb_appendf(&lit, "%s {", str.name);
 
     for (size_t i = 0; i < str.fields.count; ++i) {
-        if (i != 0) sb_appendf(&sb, ",");
+        if (i != 0) sb_appendf(&lit, ",");
         Field f = str.fields.items[i];
-        const char* format = formats[f.ft];
-        sb_appendf(&sb, " .%s = %s", f.field_name, format);
+        sb_appendf(&lit, " .%s = ", f.field_name);
+        if (is_array(f)) sb_appendf(&lit, "[");
+        flush_literal(sb, &lit, indent, mode);
+        construct_debug_field(sb, f, indent, mode);
     }
 
-    sb_appendf(&sb, " }\"");
+    sb_appendf(&lit, " }");
+    flush_literal(sb, &lit, indent, mode);
+    sb_free(lit);
+}
+
+// printers of headers are defined by every translation unit including them
+const char* linkage(Struct str) {
+    return str.header ? "CERDEB_WEAK " : "";
+}
+
+void construct_debug_write(String_Builder* sb, Struct str) {
+    sb_appendf(sb, "%sCERDEB_COLD char* %s_debug_write(char* p, const %s* str) {\n", linkage(str), str.name, str.name);
+    construct_debug_fields(sb, str, "    ", WRITE_PLAIN);
+    sb_appendf(sb, "    return p;\n}\n\n");
+}
 
+// strings without a `!max`, their length is only known at runtime
+bool has_strings(Struct str) {
     for (size_t i = 0; i < str.fields.count; ++i) {
         Field f = str.fields.items[i];
-        sb_appendf(&sb, ", str->%s", f.field_name);
+        if (f.ft == STRING && f.max == NULL) return true;
     }
-    
-    sb_appendf(&sb, ");\n}\n\n");
+    return false;
+}
+
+// strings with a `!max`, which has_strings leaves out
+bool has_strn(Struct str) {
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        if (is_strn(str.fields.items[i])) return true;
+    }
+    return false;
+}
+
+bool has_nested(Struct str) {
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        if (str.fields.items[i].ft == NESTED) return true;
+    }
+    return false;
+}
+
+bool has_follow(Struct str) {
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        if (str.fields.items[i].follow) return true;
+    }
+    return false;
+}
+
+// the length of the strings is only known at runtime, nested structs may
+// have some and followed pointers depend on the walk
+bool has_dynamic_len(Struct str) {
+    return has_strings(str) || has_nested(str) || has_follow(str);
+}
+
+// static upper bound of one value of the type of `f`
+const char* value_max_len(Field f) {
+    if (f.ft == NESTED || f.ft == ENUM) return temp_sprintf("%s_DEBUG_MAX_LEN", upper_name(f.type_name));
+    if (f.follow) return "CERDEB_FOLLOW_MAX_LEN";
+    return temp_sprintf("%zu", scalar_max_len(f));
+}
+
+// everything but the contents of the string fields has a static upper bound,
+// the one of nested structs and enums is their own NAME_DEBUG_MAX_LEN and the one of
+// arrays depends on CERDEB_ARRAY_CAP
+void construct_max_len_define(String_Builder* sb, Struct str) {
+    size_t len = strlen(str.name) + strlen(" { }");
+    String_Builder extra = {0};
+
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        Field f = str.fields.items[i];
+        len += strlen(", . = ") + strlen(f.field_name);
+
+        if (is_chars(f)) {
+            sb_appendf(&extra, " + %s", chars_len(f));
+        } else if (f.ft == STRING && f.max) {
+            sb_appendf(&extra, " + CERDEB_STR_MAX_LEN(%s)", f.max);
+        } else if (is_array(f)) {
+            sb_appendf(&extra, " + CERDEB_ARRAY_MAX_LEN(%s, %s)", f.array_len, value_max_len(f));
+        } else if (f.ft == NESTED || f.ft == ENUM || f.follow) {
+            sb_appendf(&extra, " + %s", value_max_len(f));
+        } else {
+            len += scalar_max_len(f);
+        }
+    }
+
+    if (extra.count == 0) {
+        sb_appendf(sb, "#define %s_DEBUG_MAX_LEN %zu\n\n", upper_name(str.name), len);
+    } else {
+        sb_appendf(sb, "#define %s_DEBUG_MAX_LEN (%zu%.*s)\n\n", upper_name(str.name), len, (int)extra.count, extra.items);
+    }
+    sb_free(extra);
+}
+
+// adds to `len` what the strings of the field at `value` add to its static
+// bound, the structs of `str` the field points to are walked like the writer does
+void construct_dynamic_len(String_Builder* sb, Field f, const char* value, const char* indent) {
+    if (f.ft != STRING && f.ft != NESTED && !f.follow) return;
+    if (f.max) return;
+
+    if (is_array(f)) {
+        sb_appendf(sb, "%sfor (size_t j = 0; j < CERDEB_ARRAY_SHOWN(%s); ++j) {\n", indent, f.array_len);
+        construct_dynamic_len(sb, (Field){ .ft = f.ft, .type_name = f.type_name, .follow = f.follow }, temp_sprintf("%s[j]", value), temp_sprintf("%s    ", indent));
+        sb_appendf(sb, "%s}\n", indent);
+    } else if (is_strn(f)) {
+        sb_appendf(sb, "%slen += cerdeb_strn_len(%s, %s);\n", indent, value, strn_len(f, "str"));
+    } else if (f.ft == STRING) {
+        sb_appendf(sb, "%slen += cerdeb_str_len(%s);\n", indent, value);
+    } else if (f.follow) {
+        sb_appendf(sb, "%sif (cerdeb_follow_enter(str, %s) == CERDEB_FOLLOW_GO) {\n", indent, value);
+        sb_appendf(sb, "%s    len += %s_debug_max_len(%s);\n", indent, f.type_name, value);
+        sb_appendf(sb, "%s    cerdeb_follow_leave();\n", indent);
+        sb_appendf(sb, "%s}\n", indent);
+    } else {
+        sb_appendf(sb, "%slen += %s_debug_max_len(&%s) - %s;\n", indent, f.type_name, value, value_max_len(f));
+    }
+}
+
+void construct_debug_max_len(String_Builder* sb, Struct str) {
+    sb_appendf(sb, "%sCERDEB_COLD size_t %s_debug_max_len(const %s* str) {\n", linkage(str), str.name, str.name);
+    sb_appendf(sb, "    (void)str;\n");
+    sb_appendf(sb, "    size_t len = %s_DEBUG_MAX_LEN;\n", upper_name(str.name));
+
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        Field f = str.fields.items[i];
+        construct_dynamic_len(sb, f, temp_sprintf("str->%s", f.field_name), "    ");
+    }
+
+    sb_appendf(sb, "    return len;\n}\n\n");
+}
+
+bool has_integers(Struct str) {
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        if (is_column(str.fields.items[i])) return true;
+    }
+    return false;
+}
+
+bool only_integers(Struct str) {
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        if (!is_column(str.fields.items[i])) return false;
+    }
+    return true;
+}
+
+// every record of the array is followed by a new line
+void construct_debug_write_many(String_Builder* sb, Struct str) {
+    sb_appendf(sb, "%sCERDEB_OUT_OF_LINE char* %s_debug_write_many(char* p, const %s* arr, size_t n) {\n", linkage(str), str.name, str.name);
+
+    if (has_integers(str)) {
+        // the integer fields of a whole block are formatted column by column
+        for (size_t i = 0; i < str.fields.count; ++i) {
+            Field f = str.fields.items[i];
+            if (is_column(f)) sb_appendf(sb, "    Cerdeb_Column col_%s;\n", f.field_name);
+        }
+        sb_appendf(sb, "    int64_t values[CERDEB_COLUMN_LEN];\n");
+        sb_appendf(sb, "    for (size_t base = 0; base < n; base += CERDEB_COLUMN_LEN) {\n");
+        sb_appendf(sb, "        size_t m = n - base < CERDEB_COLUMN_LEN ? n - base : CERDEB_COLUMN_LEN;\n");
+        for (size_t i = 0; i < str.fields.count; ++i) {
+            Field f = str.fields.items[i];
+            if (!is_column(f)) continue;
+            sb_appendf(sb, "        for (size_t i = 0; i < m; ++i) values[i] = arr[base + i].%s;\n", f.field_name);
+            sb_appendf(sb, "        cerdeb_format_column(&col_%s, values, m);\n", f.field_name);
+        }
+        sb_appendf(sb, "        for (size_t i = 0; i < m; ++i) {\n");
+        if (!only_integers(str)) sb_appendf(sb, "            const %s* str = &arr[base + i];\n", str.name);
+        construct_debug_fields(sb, str, "            ", WRITE_COLUMNS);
+        sb_appendf(sb, "            *p++ = '\\n';\n");
+        sb_appendf(sb, "        }\n");
+        sb_appendf(sb, "    }\n");
+    } else {
+        // the cold single record printer is not inlined, the fields are written here
+        sb_appendf(sb, "    for (size_t i = 0; i < n; ++i) {\n");
+        sb_appendf(sb, "        const %s* str = &arr[i];\n", str.name);
+        construct_debug_fields(sb, str, "        ", WRITE_PLAIN);
+        sb_appendf(sb, "        *p++ = '\\n';\n");
+        sb_appendf(sb, "    }\n");
+    }
+    sb_appendf(sb, "    return p;\n}\n\n");
+
+    sb_appendf(sb, "%sCERDEB_COLD size_t %s_debug_max_len_many(const %s* arr, size_t n) {\n", linkage(str), str.name, str.name);
+    sb_appendf(sb, "    size_t len = n * (%s_DEBUG_MAX_LEN + 1);\n", upper_name(str.name));
+    if (has_dynamic_len(str)) {
+        sb_appendf(sb, "    for (size_t i = 0; i < n; ++i) {\n");
+        sb_appendf(sb, "        const %s* str = &arr[i];\n", str.name);
+        for (size_t i = 0; i < str.fields.count; ++i) {
+            Field f = str.fields.items[i];
+            construct_dynamic_len(sb, f, temp_sprintf("str->%s", f.field_name), "        ");
+        }
+        sb_appendf(sb, "    }\n");
+    } else {
+        sb_appendf(sb, "    (void)arr;\n");
+    }
+    sb_appendf(sb, "    return len;\n}\n\n");
+}
+
+// the runtime works on type-erased arrays, the wrappers keep the casts out of it
+void construct_debug_fd_print_many(String_Builder* sb, Struct str) {
+    sb_appendf(sb, "#ifndef _WIN32\n");
+    sb_appendf(sb, "CERDEB_COLD static size_t %s__debug_max_len_many(const void* arr, size_t n) {\n", str.name);
+    sb_appendf(sb, "    return %s_debug_max_len_many((const %s*)arr, n);\n}\n\n", str.name, str.name);
+    sb_appendf(sb, "CERDEB_COLD static char* %s__debug_write_many(char* p, const void* arr, size_t n) {\n", str.name);
+    sb_appendf(sb, "    return %s_debug_write_many(p, (const %s*)arr, n);\n}\n\n", str.name, str.name);
+    sb_appendf(sb, "%sCERDEB_COLD bool %s_debug_fd_print_many(int fd, const %s* arr, size_t n, size_t threads) {\n", linkage(str), str.name, str.name);
+    sb_appendf(sb, "    return cerdeb_parallel_print(fd, arr, n, sizeof(*arr), threads, %s__debug_max_len_many, %s__debug_write_many);\n", str.name, str.name);
+    sb_appendf(sb, "}\n");
+    sb_appendf(sb, "#endif\n\n");
+}
+
+// NESTED fields are packed in place by the functions of their struct, which
+// has to be derived with `!log` too, enums whatever their size as 64 bits
+static const char* packers[] = {
+    NULL, "cerdeb_pack_i32", "cerdeb_pack_i64", "cerdeb_pack_f64",
+    "cerdeb_pack_str", "cerdeb_pack_ptr", "cerdeb_pack_char",
+    "cerdeb_pack_f32", NULL, "cerdeb_pack_u32", "cerdeb_pack_u64",
+    "cerdeb_pack_i64"
+};
+
+static const char* unpackers[] = {
+    NULL, "cerdeb_unpack_i32", "cerdeb_unpack_i64", "cerdeb_unpack_f64",
+    "cerdeb_unpack_str", "cerdeb_unpack_ptr", "cerdeb_unpack_char",
+    "cerdeb_unpack_f32", NULL, "cerdeb_unpack_u32", "cerdeb_unpack_u64",
+    "cerdeb_unpack_i64"
+};
+
+static const char* unpack_types[] = {
+    NULL, "int32_t", "int64_t", "double", "char*", "void*", "char", "float", NULL,
+    "uint32_t", "uint64_t", "int64_t"
+};
+
+// size of the packed field, strings and nested structs also add their length
+static const size_t pack_sizes[] = {
+    0, 4, 8, 8, 4, 8, 1, 4, 0, 4, 8, 8
+};
+
+// names of the field kinds in cerdeb.meta, nested structs are "struct:Name"
+// and enums "enum:Name"
+static const char* kinds[] = {
+    NULL, "i32", "i64", "f64", "str", "ptr", "char", "f32", "struct", "u32", "u64",
+    "enum"
+};
+
+// char[N] is logged as a string, the other arrays as "kind[]" and `!hex`
+// integers as "x32" or "x64"
+const char* field_kind(Field f) {
+    if (is_chars(f)) return kinds[STRING];
+    if (f.hex) return temp_sprintf("%s%s", is_narrow(f.ft) ? "x32" : "x64", f.array_len ? "[]" : "");
+    if (f.ft == ENUM) return temp_sprintf("%s:%s%s", kinds[ENUM], f.type_name, f.array_len ? "[]" : "");
+    if (is_array(f)) return temp_sprintf("%s[]", kinds[f.ft]);
+    if (f.ft == NESTED) return temp_sprintf("struct:%s", f.type_name);
+    return kinds[f.ft];
+}
+
+// FNV-1a of the name and of the layout, so a type changes id with its layout
+uint32_t log_type_id(Struct str) {
+    uint32_t hash = 2166136261u;
+    String_Builder key = {0};
+
+    sb_appendf(&key, "%s", str.name);
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        Field f = str.fields.items[i];
+        sb_appendf(&key, " %s:%s", f.field_name, field_kind(f));
+    }
+
+    for (size_t i = 0; i < key.count; ++i) {
+        hash ^= (unsigned char)key.items[i];
+        hash *= 16777619u;
+    }
+
+    sb_free(key);
+    return hash;
+}
+
+void append_log_meta(Struct str) {
+    sb_appendf(&log_meta, "type 0x%08x %s\n", log_type_id(str), str.name);
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        Field f = str.fields.items[i];
+        sb_appendf(&log_meta, "field %s %s\n", f.field_name, field_kind(f));
+    }
+    sb_appendf(&log_meta, "end\n");
+}
+
+// the constants with a value known to cerdeb, the decoder prints the others as
+// numbers
+void append_enum_meta(Enum e) {
+    sb_appendf(&log_meta, "enum %s\n", e.name);
+    for (size_t i = 0; i < e.constants.count; ++i) {
+        Constant c = e.constants.items[i];
+        if (c.known && !c.alias) sb_appendf(&log_meta, "value %lld %s\n", (long long)c.value, c.name);
+    }
+    sb_appendf(&log_meta, "end\n");
+}
+
+// arrays are packed whole, after their element count
+void construct_log(String_Builder* sb, Struct str) {
+    const char* upper = upper_name(str.name);
+    size_t fixed = 0;
+    String_Builder arrays = {0};
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        Field f = str.fields.items[i];
+        if (is_chars(f)) {
+            fixed += pack_sizes[STRING];
+        } else if (is_array(f)) {
+            sb_appendf(&arrays, " + 4 + (%s) * %zu", f.array_len, pack_sizes[f.ft]);
+        } else {
+            fixed += pack_sizes[f.ft];
+        }
+    }
+
+    sb_appendf(sb, "#define %s_LOG_TYPE_ID 0x%08xu\n", upper, log_type_id(str));
+    if (arrays.count == 0) {
+        sb_appendf(sb, "#define %s_LOG_FIXED_SIZE %zu\n\n", upper, fixed);
+    } else {
+        sb_appendf(sb, "#define %s_LOG_FIXED_SIZE (%zu%.*s)\n\n", upper, fixed, (int)arrays.count, arrays.items);
+    }
+    sb_free(arrays);
+
+    sb_appendf(sb, "%ssize_t %s_log_size(const %s* str) {\n", linkage(str), str.name, str.name);
+    sb_appendf(sb, "    (void)str;\n");
+    sb_appendf(sb, "    return %s_LOG_FIXED_SIZE", upper);
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        Field f = str.fields.items[i];
+        const char* value = temp_sprintf("str->%s", f.field_name);
+        if (is_chars(f)) sb_appendf(sb, " + cerdeb_pack_chars_size(%s, %s)", value, chars_len(f));
+        if (is_strn(f)) sb_appendf(sb, " + cerdeb_pack_strn_size(%s, %s)", value, strn_len(f, "str"));
+        if (f.array_len || is_strn(f)) continue;
+        if (f.ft == STRING) sb_appendf(sb, " + cerdeb_pack_str_size(str->%s)", f.field_name);
+        if (f.ft == NESTED) sb_appendf(sb, " + %s_log_size(&str->%s)", f.type_name, f.field_name);
+    }
+    sb_appendf(sb, ";\n}\n\n");
+
+    sb_appendf(sb, "%schar* %s_log_pack(char* p, const %s* str) {\n", linkage(str), str.name, str.name);
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        Field f = str.fields.items[i];
+        const char* value = temp_sprintf("str->%s", f.field_name);
+        if (is_chars(f)) {
+            sb_appendf(sb, "    p = cerdeb_pack_chars(p, %s, %s);\n", value, chars_len(f));
+        } else if (is_strn(f)) {
+            sb_appendf(sb, "    p = cerdeb_pack_strn(p, %s, %s);\n", value, strn_len(f, "str"));
+        } else if (is_array(f)) {
+            sb_appendf(sb, "    p = cerdeb_pack_u32(p, %s);\n", f.array_len);
+            sb_appendf(sb, "    for (size_t j = 0; j < (%s); ++j) p = %s(p, str->%s[j]);\n", f.array_len, packers[f.ft], f.field_name);
+        } else if (f.ft == NESTED) {
+            sb_appendf(sb, "    p = %s_log_pack(p, &str->%s);\n", f.type_name, f.field_name);
+        } else {
+            sb_appendf(sb, "    p = %s(p, str->%s);\n", packers[f.ft], f.field_name);
+        }
+    }
+    sb_appendf(sb, "    return p;\n}\n\n");
+
+    sb_appendf(sb, "%sconst char* %s_log_unpack(%s* str, const char* p) {\n", linkage(str), str.name, str.name);
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        Field f = str.fields.items[i];
+        if (is_chars(f)) {
+            sb_appendf(sb, "    p = cerdeb_unpack_chars(p, (char*)str->%s, %s);\n", f.field_name, f.array_len);
+        } else if (is_array(f)) {
+            // a record of another build may have another count
+            sb_appendf(sb, "    {\n");
+            sb_appendf(sb, "        uint32_t count;\n");
+            sb_appendf(sb, "        p = cerdeb_unpack_u32(p, &count);\n");
+            sb_appendf(sb, "        for (size_t j = 0; j < count; ++j) {\n");
+            sb_appendf(sb, "            %s v;\n", unpack_types[f.ft]);
+            sb_appendf(sb, "            p = %s(p, &v);\n", unpackers[f.ft]);
+            sb_appendf(sb, "            if (j < (%s)) str->%s[j] = v;\n", f.array_len, f.field_name);
+            sb_appendf(sb, "        }\n");
+            sb_appendf(sb, "    }\n");
+        } else if (f.ft == NESTED) {
+            sb_appendf(sb, "    p = %s_log_unpack((%s*)&str->%s, p);\n", f.type_name, f.type_name, f.field_name);
+        } else {
+            sb_appendf(sb, "    { %s v; p = %s(p, &v); str->%s = v; }\n", unpack_types[f.ft], unpackers[f.ft], f.field_name);
+        }
+    }
+    sb_appendf(sb, "    return p;\n}\n\n");
+
+    // used by the background thread of the async backend
+    sb_appendf(sb, "#if CERDEB_PRINTERS\n");
+    sb_appendf(sb, "CERDEB_COLD static char* %s__log_render(char* p, char* end, const char* payload) {\n", str.name);
+    sb_appendf(sb, "    %s str;\n", str.name);
+    sb_appendf(sb, "    %s_log_unpack(&str, payload);\n", str.name);
+    sb_appendf(sb, "    if ((size_t)(end - p) < %s_debug_max_len(&str) + 1) return NULL;\n", str.name);
+    sb_appendf(sb, "    p = %s_debug_write(p, &str);\n", str.name);
+    sb_appendf(sb, "    *p++ = '\\n';\n");
+    sb_appendf(sb, "    return p;\n}\n");
+    sb_appendf(sb, "#endif\n\n");
+
+    sb_appendf(sb, "%svoid %s_log(const %s* str) {\n", linkage(str), str.name, str.name);
+    sb_appendf(sb, "    uint32_t size = (uint32_t)%s_log_size(str);\n", str.name);
+    sb_appendf(sb, "    char* p = cerdeb_log_reserve(%s_LOG_TYPE_ID, size, CERDEB_RENDER(%s__log_render));\n", upper, str.name);
+    sb_appendf(sb, "    if (p == NULL) return;\n");
+    sb_appendf(sb, "    %s_log_pack(p, str);\n", str.name);
+    sb_appendf(sb, "    cerdeb_log_commit();\n");
+    sb_appendf(sb, "}\n\n");
+
+    sb_appendf(sb, "%svoid %s_flight(const %s* str) {\n", linkage(str), str.name, str.name);
+    sb_appendf(sb, "    char* p = cerdeb_flight_reserve(%s_LOG_TYPE_ID, (uint32_t)%s_log_size(str));\n", upper, str.name);
+    sb_appendf(sb, "    if (p == NULL) return;\n");
+    sb_appendf(sb, "    %s_log_pack(p, str);\n", str.name);
+    sb_appendf(sb, "    cerdeb_flight_commit(p);\n");
+    sb_appendf(sb, "}\n\n");
+}
+
+// only stack memory, the in-house formatters and write(2)
+void construct_debug_write_signal_safe(String_Builder* sb, Struct str) {
+    sb_appendf(sb, "#ifndef _WIN32\n");
+
+    // `buf` holds CERDEB_SIGNAL_SAFE_BUF bytes whatever the size of the
+    // struct, it is flushed before every value that might not fit
+    sb_appendf(sb, "%sCERDEB_COLD char* %s_debug_write_fd(int fd, char* buf, char* p, const %s* str) {\n", linkage(str), str.name, str.name);
+    construct_debug_fields(sb, str, "    ", WRITE_SIGNAL_SAFE);
+    sb_appendf(sb, "    return p;\n}\n\n");
+
+    sb_appendf(sb, "%sCERDEB_COLD void %s_debug_write_signal_safe(int fd, const %s* str) {\n", linkage(str), str.name, str.name);
+    sb_appendf(sb, "    int saved_errno = errno;\n");
+    sb_appendf(sb, "    char buf[CERDEB_SIGNAL_SAFE_BUF];\n");
+    sb_appendf(sb, "    char* p = %s_debug_write_fd(fd, buf, buf, str);\n", str.name);
+    sb_appendf(sb, "    p = cerdeb_room_fd(fd, buf, p, 1);\n");
+    sb_appendf(sb, "    *p++ = '\\n';\n");
+    sb_appendf(sb, "    cerdeb_flush_fd(fd, buf, p);\n");
+    sb_appendf(sb, "    errno = saved_errno;\n");
+    sb_appendf(sb, "}\n");
+    sb_appendf(sb, "#endif\n\n");
+}
+
+// the handle keeps the formatting out of the disabled log calls
+void construct_debug_lazy(String_Builder* sb, Struct str) {
+    sb_appendf(sb, "CERDEB_COLD static size_t %s__debug_max_len(const void* str) {\n", str.name);
+    sb_appendf(sb, "    return %s_debug_max_len((const %s*)str);\n}\n\n", str.name, str.name);
+    sb_appendf(sb, "CERDEB_COLD static char* %s__debug_write(char* p, const void* str) {\n", str.name);
+    sb_appendf(sb, "    return %s_debug_write(p, (const %s*)str);\n}\n\n", str.name, str.name);
+    sb_appendf(sb, "%sCerdeb_Lazy %s_debug_lazy(const %s* str) {\n", linkage(str), str.name, str.name);
+    sb_appendf(sb, "    return (Cerdeb_Lazy){ str, %s__debug_max_len, %s__debug_write };\n}\n\n", str.name, str.name);
+
+    // the CERDEB_ERROR ... CERDEB_TRACE macros check the level before the call
+    sb_appendf(sb, "%sCERDEB_COLD void %s_debug_emit(int level, const %s* str) {\n", linkage(str), str.name, str.name);
+    if (str.cache) {
+        sb_appendf(sb, "    size_t len;\n");
+        sb_appendf(sb, "    const char* text = %s__debug_cached(str, &len);\n", str.name);
+        sb_appendf(sb, "    if (text) cerdeb__emit_text(level, text, len);\n");
+        sb_appendf(sb, "    else cerdeb__emit(level, %s_debug_lazy(str));\n}\n\n", str.name);
+    } else {
+        sb_appendf(sb, "    cerdeb__emit(level, %s_debug_lazy(str));\n}\n\n", str.name);
+    }
+}
+
+// the characters of the strings of `str` and of its nested structs, their
+// bytes are hashed with the ones of the outermost struct
+void construct_debug_hash(String_Builder* sb, Struct str) {
+    sb_appendf(sb, "%sCERDEB_OUT_OF_LINE uint64_t %s_debug_hash_strings(uint64_t h, const %s* str) {\n", linkage(str), str.name, str.name);
+    if (!has_strings(str) && !has_nested(str) && !has_strn(str)) sb_appendf(sb, "    (void)str;\n");
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        Field f = str.fields.items[i];
+        const char* value = temp_sprintf("str->%s", f.field_name);
+        const char* indent = "    ";
+        if (f.ft != STRING && f.ft != NESTED) continue;
+
+        if (is_array(f)) {
+            sb_appendf(sb, "    for (size_t j = 0; j < (%s); ++j) {\n", f.array_len);
+            value = temp_sprintf("%s[j]", value);
+            indent = "        ";
+        }
+        if (is_strn(f)) {
+            sb_appendf(sb, "%sh = cerdeb_hash_strn(h, %s, %s);\n", indent, value, strn_len(f, "str"));
+        } else if (f.ft == STRING) {
+            sb_appendf(sb, "%sh = cerdeb_hash_str(h, %s);\n", indent, value);
+        } else {
+            sb_appendf(sb, "%sh = %s_debug_hash_strings(h, &%s);\n", indent, f.type_name, value);
+        }
+        if (is_array(f)) sb_appendf(sb, "    }\n");
+    }
+    sb_appendf(sb, "    return h;\n}\n\n");
+}
+
+// formats `str` only if the text of its hash isn't in the cache of the thread
+void construct_debug_cached(String_Builder* sb, Struct str) {
+    sb_appendf(sb, "CERDEB_OUT_OF_LINE static const char* %s__debug_cached(const %s* str, size_t* len) {\n", str.name, str.name);
+    sb_appendf(sb, "    static CERDEB_THREAD_LOCAL Cerdeb_Cache cache;\n");
+    sb_appendf(sb, "    uint64_t hash = cerdeb_hash(CERDEB_HASH_SEED, str, sizeof(*str));\n");
+    sb_appendf(sb, "    hash = %s_debug_hash_strings(hash, str);\n", str.name);
+    sb_appendf(sb, "    Cerdeb_Cache_Slot* slot = cerdeb_cache_find(&cache, hash);\n");
+    sb_appendf(sb, "    if (slot == NULL) {\n");
+    sb_appendf(sb, "        slot = cerdeb_cache_reserve(&cache, hash, %s_debug_max_len(str));\n", str.name);
+    sb_appendf(sb, "        if (slot == NULL) return NULL;\n");
+    sb_appendf(sb, "        slot->len = %s_debug_write(slot->text, str) - slot->text;\n", str.name);
+    sb_appendf(sb, "        slot->text[slot->len] = '\\0';\n");
+    sb_appendf(sb, "    }\n");
+    sb_appendf(sb, "    *len = slot->len;\n");
+    sb_appendf(sb, "    return slot->text;\n}\n\n");
+
+    sb_appendf(sb, "%sCERDEB_OUT_OF_LINE const char* %s_debug_print_cached(const %s* str) {\n", linkage(str), str.name, str.name);
+    sb_appendf(sb, "    size_t len;\n");
+    sb_appendf(sb, "    const char* text = %s__debug_cached(str, &len);\n", str.name);
+    sb_appendf(sb, "    return text ? text : %s_debug_print(str);\n}\n\n", str.name);
+}
+
+// fields compared byte for byte, a run of them is compared with one memcmp
+// first, padding included, and field by field only if that one differs
+bool is_plain(Field f) {
+    return !is_chars(f) && f.ft != STRING && f.ft != NESTED;
+}
+
+const char* value_differs(Field f, const char* a, const char* b) {
+    if (f.ft == STRING) return temp_sprintf("!cerdeb_str_equal(%s, %s)", a, b);
+    return temp_sprintf("!%s_debug_equal(&%s, &%s)", f.type_name, a, b);
+}
+
+// sets `differs` if the field `f` of `a` and `b` is printed differently
+void construct_field_differs(String_Builder* sb, Field f, const char* indent) {
+    const char* a = temp_sprintf("a->%s", f.field_name);
+    const char* b = temp_sprintf("b->%s", f.field_name);
+    if (is_plain(f)) {
+        sb_appendf(sb, "%sdiffers = memcmp(&%s, &%s, sizeof(%s)) != 0;\n", indent, a, b, a);
+    } else if (is_chars(f)) {
+        sb_appendf(sb, "%sdiffers = strncmp(%s, %s, %s) != 0;\n", indent, a, b, chars_len(f));
+    } else if (is_strn(f)) {
+        sb_appendf(sb, "%sdiffers = !cerdeb_strn_equal(%s, %s, %s, %s);\n", indent, a, strn_len(f, "a"), b, strn_len(f, "b"));
+    } else if (is_array(f)) {
+        sb_appendf(sb, "%sdiffers = false;\n", indent);
+        sb_appendf(sb, "%sfor (size_t j = 0; j < (%s) && !differs; ++j) differs = %s;\n", indent, f.array_len,
+                   value_differs(f, temp_sprintf("%s[j]", a), temp_sprintf("%s[j]", b)));
+    } else {
+        sb_appendf(sb, "%sdiffers = %s;\n", indent, value_differs(f, a, b));
+    }
+}
+
+// `then` runs for every field that differs, the runs of plain fields are skipped at once
+void construct_diff_fields(String_Builder* sb, Struct str, void (*then)(String_Builder*, Struct, Field, const char*)) {
+    for (size_t i = 0; i < str.fields.count;) {
+        size_t end = i + 1;
+        while (is_plain(str.fields.items[i]) && end < str.fields.count && is_plain(str.fields.items[end])) ++end;
+
+        const char* indent = "    ";
+        if (end - i > 1) {
+            const char* first = str.fields.items[i].field_name;
+            const char* last = str.fields.items[end - 1].field_name;
+            sb_appendf(sb, "    if (memcmp(&a->%s, &b->%s, CERDEB_SPAN(%s, %s, %s)) != 0) {\n", first, first, str.name, first, last);
+            indent = "        ";
+        }
+
+        for (; i < end; ++i) {
+            Field f = str.fields.items[i];
+            construct_field_differs(sb, f, indent);
+            then(sb, str, f, indent);
+        }
+
+        if (strlen(indent) > 4) sb_appendf(sb, "    }\n");
+    }
+}
+
+void construct_equal_field(String_Builder* sb, Struct str, Field f, const char* indent) {
+    (void)str;
+    (void)f;
+    sb_appendf(sb, "%sif (differs) return false;\n", indent);
+}
+
+// nested structs print their own diff, the rest both values
+void construct_diff_field(String_Builder* sb, Struct str, Field f, const char* indent) {
+    const char* inner = temp_sprintf("%s    ", indent);
+    const char* name = temp_sprintf(" .%s = %s", f.field_name, is_array(f) ? "[" : "");
+    sb_appendf(sb, "%sif (differs) {\n", indent);
+    sb_appendf(sb, "%sp = cerdeb_write_diff_field(p, start, \"%s\", %zu);\n", inner, name, strlen(name));
+    if (f.ft == NESTED && !is_array(f)) {
+        sb_appendf(sb, "%sp = %s_debug_write_diff(p, &a->%s, &b->%s);\n", inner, f.type_name, f.field_name, f.field_name);
+    } else if (is_array(f)) {
+        // the arrays are compared whole, their prints can be the same
+        const char* a = temp_sprintf("a->%s", f.field_name);
+        const char* b = temp_sprintf("b->%s", f.field_name);
+        const char* deeper = temp_sprintf("%s    ", inner);
+        if (is_plain(f)) {
+            sb_appendf(sb, "%sbool shown_differ = memcmp(%s, %s, CERDEB_ARRAY_SHOWN(%s) * sizeof(%s[0])) != 0;\n", inner, a, b, f.array_len, a);
+        } else {
+            sb_appendf(sb, "%sbool shown_differ = false;\n", inner);
+            sb_appendf(sb, "%sfor (size_t j = 0; j < CERDEB_ARRAY_SHOWN(%s) && !shown_differ; ++j) shown_differ = %s;\n", inner,
+                       f.array_len, value_differs(f, temp_sprintf("%s[j]", a), temp_sprintf("%s[j]", b)));
+        }
+        sb_appendf(sb, "%sif (!shown_differ) {\n", inner);
+        sb_appendf(sb, "%sp = cerdeb_write_lit(p, \"...] -> [...]\", 13);\n", deeper);
+        sb_appendf(sb, "%s} else {\n", inner);
+        sb_appendf(sb, "%sconst %s* str = a;\n", deeper, str.name);
+        construct_debug_field(sb, f, deeper, WRITE_PLAIN);
+        sb_appendf(sb, "%sp = cerdeb_write_lit(p, \" -> [\", 5);\n", deeper);
+        sb_appendf(sb, "%sstr = b;\n", deeper);
+        construct_debug_field(sb, f, deeper, WRITE_PLAIN);
+        sb_appendf(sb, "%s}\n", inner);
+    } else {
+        // followed pointers are compared and printed as addresses
+        f.follow = false;
+        sb_appendf(sb, "%sconst %s* str = a;\n", inner, str.name);
+        construct_debug_field(sb, f, inner, WRITE_PLAIN);
+        sb_appendf(sb, "%sp = cerdeb_write_lit(p, \" -> \", 4);\n", inner);
+        sb_appendf(sb, "%sstr = b;\n", inner);
+        construct_debug_field(sb, f, inner, WRITE_PLAIN);
+    }
+    sb_appendf(sb, "%s}\n", indent);
+}
+
+// what a diff adds to the two records: " -> " for every field, the nested
+// structs add their own
+void construct_diff_extra_define(String_Builder* sb, Struct str) {
+    sb_appendf(sb, "#define %s_DEBUG_DIFF_EXTRA (%zu", upper_name(str.name), 4 * str.fields.count);
+    for (size_t i = 0; i < str.fields.count; ++i) {
+        Field f = str.fields.items[i];
+        if (f.ft == NESTED && !is_array(f)) sb_appendf(sb, " + %s_DEBUG_DIFF_EXTRA", upper_name(f.type_name));
+    }
+    sb_appendf(sb, ")\n\n");
+}
+
+void construct_debug_equal(String_Builder* sb, Struct str) {
+    sb_appendf(sb, "%sbool %s_debug_equal(const %s* a, const %s* b) {\n", linkage(str), str.name, str.name, str.name);
+    if (str.fields.count == 0) {
+        sb_appendf(sb, "    (void)a;\n");
+        sb_appendf(sb, "    (void)b;\n");
+    } else {
+        sb_appendf(sb, "    bool differs;\n");
+        construct_diff_fields(sb, str, construct_equal_field);
+    }
+    sb_appendf(sb, "    return true;\n}\n\n");
+}
+
+// "Name { .x = 1 -> 2 }" with the fields that differ only
+void construct_debug_diff(String_Builder* sb, Struct str) {
+    sb_appendf(sb, "%sCERDEB_COLD char* %s_debug_write_diff(char* p, const %s* a, const %s* b) {\n", linkage(str), str.name, str.name, str.name);
+    sb_appendf(sb, "    p = cerdeb_write_lit(p, \"%s {\", %zu);\n", str.name, strlen(str.name) + 2);
+    if (str.fields.count == 0) {
+        sb_appendf(sb, "    (void)a;\n");
+        sb_appendf(sb, "    (void)b;\n");
+    } else {
+        sb_appendf(sb, "    const char* start = p;\n");
+        sb_appendf(sb, "    bool differs;\n");
+        construct_diff_fields(sb, str, construct_diff_field);
+    }
+    sb_appendf(sb, "    return cerdeb_write_lit(p, \" }\", 2);\n}\n\n");
+
+    sb_appendf(sb, "%sCERDEB_COLD size_t %s_debug_max_len_diff(const %s* a, const %s* b) {\n", linkage(str), str.name, str.name, str.name);
+    sb_appendf(sb, "    return %s_debug_max_len(a) + %s_debug_max_len(b) + %s_DEBUG_DIFF_EXTRA;\n}\n\n", str.name, str.name, upper_name(str.name));
+
+    sb_appendf(sb, "%sCERDEB_COLD char* %s_debug_diff(const %s* a, const %s* b) {\n", linkage(str), str.name, str.name, str.name);
+    sb_appendf(sb, "    char* buf = temp_alloc(%s_debug_max_len_diff(a, b) + 1);\n", str.name);
+    sb_appendf(sb, "    if (buf == NULL) return NULL;\n");
+    sb_appendf(sb, "    *%s_debug_write_diff(buf, a, b) = '\\0';\n", str.name);
+    sb_appendf(sb, "    return buf;\n}\n\n");
+}
+
+String_Builder construct_debug_print(Struct str) {
+    String_Builder sb = {0};
+
+    sb_appendf(&sb, "\n");
+    construct_max_len_define(&sb, str);
+    construct_diff_extra_define(&sb, str);
+    construct_debug_equal(&sb, str);
+
+    // the text printers are left out of builds with CERDEB_LEVEL_OFF
+    sb_appendf(&sb, "#if CERDEB_PRINTERS\n");
+    construct_debug_write(&sb, str);
+    construct_debug_max_len(&sb, str);
+    construct_debug_write_many(&sb, str);
+
+    // TODO: dont use nob as a dependecy for using this constructed function
+    // the text lives in nob's temporary storage, NULL once it is full
+    sb_appendf(&sb, "%sCERDEB_COLD char* %s_debug_print(const %s* str) {\n", linkage(str), str.name, str.name);
+    if (has_dynamic_len(str)) {
+        sb_appendf(&sb, "    char* buf = temp_alloc(%s_debug_max_len(str) + 1);\n", str.name);
+    } else {
+        sb_appendf(&sb, "    char* buf = temp_alloc(%s_DEBUG_MAX_LEN + 1);\n", upper_name(str.name));
+    }
+    sb_appendf(&sb, "    if (buf == NULL) return NULL;\n");
+    sb_appendf(&sb, "    *%s_debug_write(buf, str) = '\\0';\n", str.name);
+    sb_appendf(&sb, "    return buf;\n}\n\n");
+
+    construct_debug_fd_print_many(&sb, str);
+    construct_debug_write_signal_safe(&sb, str);
+
+    sb_appendf(&sb, "%sCERDEB_COLD char* %s_debug_print_many(const %s* arr, size_t n) {\n", linkage(str), str.name, str.name);
+    sb_appendf(&sb, "    char* buf = temp_alloc(%s_debug_max_len_many(arr, n) + 1);\n", str.name);
+    sb_appendf(&sb, "    if (buf == NULL) return NULL;\n");
+    sb_appendf(&sb, "    *%s_debug_write_many(buf, arr, n) = '\\0';\n", str.name);
+    sb_appendf(&sb, "    return buf;\n}\n\n");
+
+    construct_debug_diff(&sb, str);
+    if (str.cache) {
+        construct_debug_hash(&sb, str);
+        construct_debug_cached(&sb, str);
+    }
+
+    construct_debug_lazy(&sb, str);
+
+    // makes the struct visible to cerdeb_debug in the files that see it
+    sb_appendf(&sb, "#undef CERDEB__SLOT_%zu\n", str.slot);
+    sb_appendf(&sb, "#define CERDEB__SLOT_%zu , %s*: %s_debug_print, const %s*: %s_debug_print\n", str.slot, str.name, str.name, str.name, str.name);
+    sb_appendf(&sb, "#endif // CERDEB_PRINTERS\n\n");
+
+    if (str.log) construct_log(&sb, str);
+    sb_append_null(&sb);
+
+    return sb;
+}
+
+// at most half of the table is left empty, the other enums use a switch
+bool is_dense(Enum e, int64_t* min, uint64_t* range) {
+    size_t names = 0;
+    for (size_t i = 0; i < e.constants.count; ++i) {
+        Constant c = e.constants.items[i];
+        if (!c.known) return false;
+        if (c.alias) continue;
+        if (names == 0 || c.value < *min) *min = c.value;
+        names += 1;
+    }
+
+    int64_t max = *min;
+    for (size_t i = 0; i < e.constants.count; ++i) {
+        if (e.constants.items[i].value > max) max = e.constants.items[i].value;
+    }
+    *range = (uint64_t)max - (uint64_t)*min + 1;
+    return *range != 0 && *range <= 2 * names;
+}
+
+// the values without a name print as "(Name)42"
+String_Builder construct_enum_debug(Enum e) {
+    String_Builder sb = {0};
+    const char* cast = temp_sprintf("(%s)", e.name);
+
+    size_t max_len = strlen(cast) + 20;
+    for (size_t i = 0; i < e.constants.count; ++i) {
+        size_t len = strlen(e.constants.items[i].name);
+        if (len > max_len) max_len = len;
+    }
+
+    sb_appendf(&sb, "\n");
+    sb_appendf(&sb, "#define %s_DEBUG_MAX_LEN %zu\n\n", upper_name(e.name), max_len);
+
+    int64_t min = 0;
+    uint64_t range = 0;
+    sb_appendf(&sb, "static inline Cerdeb_Name %s__debug_name(%s value) {\n", e.name, e.name);
+    if (is_dense(e, &min, &range)) {
+        // indexed by the value, the holes have no name
+        const char** names = temp_alloc(range * sizeof(*names));
+        memset(names, 0, range * sizeof(*names));
+        for (size_t i = 0; i < e.constants.count; ++i) {
+            Constant c = e.constants.items[i];
+            if (!c.alias) names[(uint64_t)c.value - (uint64_t)min] = c.name;
+        }
+
+        sb_appendf(&sb, "    static const Cerdeb_Name names[%llu] = {\n", (unsigned long long)range);
+        for (uint64_t i = 0; i < range; ++i) {
+            if (names[i]) sb_appendf(&sb, "        CERDEB_NAME(\"%s\"),\n", names[i]);
+            else sb_appendf(&sb, "        {0},\n");
+        }
+        sb_appendf(&sb, "    };\n");
+        if (min == 0) {
+            sb_appendf(&sb, "    uint64_t i = (uint64_t)value;\n");
+        } else {
+            sb_appendf(&sb, "    uint64_t i = (uint64_t)value - (uint64_t)%lldll;\n", (long long)min);
+        }
+        sb_appendf(&sb, "    return i < %llu ? names[i] : (Cerdeb_Name){0};\n", (unsigned long long)range);
+    } else {
+        // sparse values, the ones only the compiler knows are compared one by one
+        bool any_known = false;
+        for (size_t i = 0; i < e.constants.count; ++i) any_known = any_known || e.constants.items[i].known;
+        if (any_known) {
+            sb_appendf(&sb, "    switch (value) {\n");
+            for (size_t i = 0; i < e.constants.count; ++i) {
+                Constant c = e.constants.items[i];
+                if (c.known && !c.alias) sb_appendf(&sb, "        case %s: return (Cerdeb_Name)CERDEB_NAME(\"%s\");\n", c.name, c.name);
+            }
+            sb_appendf(&sb, "        default: break;\n");
+            sb_appendf(&sb, "    }\n");
+        }
+        for (size_t i = 0; i < e.constants.count; ++i) {
+            Constant c = e.constants.items[i];
+            if (!c.known) sb_appendf(&sb, "    if (value == %s) return (Cerdeb_Name)CERDEB_NAME(\"%s\");\n", c.name, c.name);
+        }
+        sb_appendf(&sb, "    return (Cerdeb_Name){0};\n");
+    }
+    sb_appendf(&sb, "}\n\n");
+
+    sb_appendf(&sb, "static inline const char* %s_debug_name(%s value) {\n", e.name, e.name);
+    sb_appendf(&sb, "    return %s__debug_name(value).text;\n}\n\n", e.name);
+
+    sb_appendf(&sb, "#if CERDEB_PRINTERS\n");
+    sb_appendf(&sb, "static inline char* %s_debug_write(char* p, %s value) {\n", e.name, e.name);
+    sb_appendf(&sb, "    return cerdeb_write_enum(p, %s__debug_name(value), \"%s\", %zu, (int64_t)value);\n}\n", e.name, cast, strlen(cast));
+    sb_appendf(&sb, "#endif // CERDEB_PRINTERS\n\n");
     sb_append_null(&sb);
 
     return sb;
@@ -238,29 +1622,42 @@ bool ends_width(const char* string, const char* suffix) {
     return true;
 }
 
-size_t insert_debug_print(String_Builder *file, const char* print, size_t where, size_t comment) {
+size_t insert_debug_print(String_Builder *file, const char* print, size_t where, size_t comment, bool first) {
     assert(print);
     assert(file);
 
-    const char* pre = "// ";
+    // the runtime has to be visible before the first generated printer
+    const char* pre = first ? "#include \"cerdeb.h\"\n// " : "// ";
     sb_insert_at(file, pre, comment);
     sb_insert_at(file, print, where + strlen(pre));
 
     return strlen(print) + strlen(pre);
 }
 
+// the structs and the enums are inserted in the order of the file
 void insert_debug_prints(String_Builder* file) {
     size_t offset = 0;
+    size_t next_struct = 0;
+    size_t next_enum = 0;
     String_Builder debug_print = {0};
-    for (size_t i = 0; i < structs.count; ++i) {
-        Struct str = structs.items[i];
-
+    for (size_t i = 0; i < structs.count + enums.count; ++i) {
+        size_t where, where_comment;
         debug_print.count = 0;
-        size_t where = str.pos_print + offset;
-        size_t where_comment = str.pos_comment + offset;
-        debug_print = construct_debug_print(str);
 
-        offset += insert_debug_print(file, debug_print.items, where, where_comment);
+        if (next_enum < enums.count &&
+            (next_struct == structs.count || enums.items[next_enum].pos_print < structs.items[next_struct].pos_print)) {
+            Enum e = enums.items[next_enum++];
+            where = e.pos_print + offset;
+            where_comment = e.pos_comment + offset;
+            debug_print = construct_enum_debug(e);
+        } else {
+            Struct str = structs.items[next_struct++];
+            where = str.pos_print + offset;
+            where_comment = str.pos_comment + offset;
+            debug_print = construct_debug_print(str);
+        }
+
+        offset += insert_debug_print(file, debug_print.items, where, where_comment, i == 0);
     }
 
     sb_free(debug_print);
@@ -277,10 +1674,14 @@ bool generate_file(String_Builder file, const char* file_name) {
     return true;
 }
 
-bool parse_file(char* file_path) {
+// with `names_only` the derived enums are added to known_enums, the names of
+// the derived structs to known_structs and nothing is generated
+bool parse_file(char* file_path, bool names_only, bool implementation) {
     String_Builder file = {0};
     if (!read_entire_file(file_path, &file)) return false;
     stb_c_lexer_init(&lex, file.items, file.items + file.count, string_store, BUF_LEN);
+    structs.count = 0;
+    enums.count = 0;
 
     size_t where_comment = 0;
     size_t scope_depth = 0;
@@ -291,39 +1692,101 @@ bool parse_file(char* file_path) {
         }
 
         bool debug = false;
+        Struct str = { .header = ends_width(file_path, ".h") };
         switch (lex.token) {
             case '{': ++scope_depth; break;
             case '}': --scope_depth; break;
             default: { 
                 where_comment = lex.where_firstchar - lex.input_stream;
-                if (scope_depth == 0 && expect_char('!') && expect_id_name("debug")) debug = true;
+                if (scope_depth == 0 && parse_derives(&str)) debug = true;
             }
         }
 
         if (debug) {
-            if (!parse_struct(where_comment)) return false;
+            if (!expect_id_name("typedef")) return false;
+            if (expect_id_name("enum")) {
+                if (!parse_enum(str, where_comment, names_only ? &known_enums : &enums)) return false;
+                if (names_only) append_enum_meta(da_last(&known_enums));
+            } else if (names_only) {
+                if (!parse_struct_name(str)) return false;
+            } else {
+                if (!parse_struct(str, where_comment)) return false;
+            }
             debug = false;
         } else {
             if (!stb_c_lexer_get_token(&lex)) break;
         }
     }
 
+    if (names_only) {
+        sb_free(file);
+        return true;
+    }
+
+    for (size_t i = 0; i < structs.count; ++i) {
+        structs.items[i].slot = slot_count++;
+        if (structs.items[i].log) append_log_meta(structs.items[i]);
+    }
+
     insert_debug_prints(&file);
+    if (implementation) sb_append_cstr(&file, "\n#define CERDEB_IMPLEMENTATION\n#include \"cerdeb.h\"\n");
     if (!generate_file(file, basename(file_path))) return false;
     sb_free(file);
     return true;
 }
 
+// cerdeb_debug is a _Generic over a slot for every struct of the build. The
+// slots start empty and the printers of a struct fill its own one, so every
+// file only dispatches on the structs it can see
+void append_debug_dispatch(String_Builder* sb) {
+    sb_appendf(sb, "\n#ifndef CERDEB_DISPATCH_H_\n");
+    sb_appendf(sb, "#define CERDEB_DISPATCH_H_\n\n");
+    for (size_t i = 0; i < slot_count; ++i) {
+        sb_appendf(sb, "#ifndef CERDEB__SLOT_%zu\n#define CERDEB__SLOT_%zu\n#endif\n", i, i);
+    }
+
+    sb_appendf(sb, "\n#if CERDEB_PRINTERS\n");
+    sb_appendf(sb, "typedef struct Cerdeb__None Cerdeb__None;\n\n");
+    sb_appendf(sb, "#define cerdeb_debug(ptr) _Generic((ptr), \\\n");
+    sb_appendf(sb, "    Cerdeb__None*: NULL");
+    for (size_t i = 0; i < slot_count; ++i) sb_appendf(sb, " \\\n    CERDEB__SLOT_%zu", i);
+    sb_appendf(sb, ")(ptr)\n");
+    sb_appendf(sb, "#else\n");
+    sb_appendf(sb, "#define cerdeb_debug(ptr) ((void)sizeof(ptr), (char*)\"\")\n");
+    sb_appendf(sb, "#endif\n\n");
+    sb_appendf(sb, "#endif // CERDEB_DISPATCH_H_\n");
+}
+
 bool parse_files(size_t argc, char** argv) {
     if (!mkdir_if_not_exists(BUILD_DIR)) return 1;
 
+    // the runtime is implemented in the first source file, headers may be
+    // included by more than one translation unit
+    bool implemented = false;
+
+    // the fields can only tell enums from structs, and derived structs from
+    // the others, once the names of every file are known
+    for (size_t i = 1; i < argc; ++i) {
+        if (*argv[i] == '-') break;
+        if (!parse_file(argv[i], true, false)) return false;
+    }
+
     // TODO: input files must be the first files provided for now
     for (size_t i = 1; i < argc; ++i) {
         if (*argv[i] == '-') break;
-        if (!parse_file(argv[i])) return false;
+        bool implementation = !implemented && !ends_width(argv[i], ".h");
+        if (!parse_file(argv[i], false, implementation)) return false;
+        implemented = implemented || implementation;
     }
 
-    return true;
+    // the dispatch needs every struct of the build, the header is written last
+    String_Builder runtime = {0};
+    if (!read_entire_file(RUNTIME_HEADER, &runtime)) return false;
+    append_debug_dispatch(&runtime);
+    if (!write_entire_file(BUILD_DIR"cerdeb.h", runtime.items, runtime.count)) return false;
+    sb_free(runtime);
+
+    return write_entire_file(BUILD_DIR"cerdeb.meta", log_meta.items, log_meta.count);
 }
 
 bool compile_files(size_t argc, char** argv) {
@@ -331,24 +1794,47 @@ bool compile_files(size_t argc, char** argv) {
     nob_cc(&comp);
 
     size_t i = 1;
-    String_Builder sb = {0};
     for (; i < argc; ++i) {
         if (*argv[i] == '-') break;
+        cmd_append(&comp, temp_sprintf("%s%s", BUILD_DIR, basename(argv[i])));
+    }
 
-        sb.count = 0;
-        sb_appendf(&sb, "%s%s", BUILD_DIR, basename(argv[i]));
-        sb_append_null(&sb);
-
-        cmd_append(&comp, sb.items);
+    // every function gets its own section, the linker drops the unused ones
+    if (gc_sections) {
+        cmd_append(&comp, "-DCERDEB_SPLIT_SECTIONS", "-ffunction-sections", "-fdata-sections");
+#ifdef __APPLE__
+        cmd_append(&comp, "-Wl,-dead_strip");
+#else
+        cmd_append(&comp, "-Wl,--gc-sections");
+#endif
     }
 
     for (; i < argc; ++i) cmd_append(&comp, argv[i]);
     if (!cmd_run(&comp)) return false;
-    sb_free(sb);
+    return true;
+}
+
+// the options of cerdeb come before the input files, returns how many there are
+bool parse_options(size_t argc, char** argv, size_t* count) {
+    size_t i = 1;
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; ++i) {
+        if (strcmp(argv[i], "--gc-sections") == 0) {
+            gc_sections = true;
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return false;
+        }
+    }
+
+    *count = i - 1;
     return true;
 }
 
 int main(int argc, char** argv) {
+    size_t options = 0;
+    if (!parse_options(argc, argv, &options)) return 1;
+    argc -= options;
+    argv += options;
     assert(argc >= 2);
 
     // TODO: build a better lexer for this job instead of using stb_c_lexer
@@ -0,0 +1,62 @@
+// The async backend in binary mode: threads started one after the other each
+// take over the ring of the previous one, so their records reach the log in
+// the order they are printed on stdout
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#define NOB_STRIP_PREFIX
+#define NOB_IMPLEMENTATION
+#include "nob.h"
+#include "test.h"
+
+#define THREADS 200
+#define EVENTS 100
+
+!log
+typedef struct {
+    int thread;
+    int i;
+    char* name;
+    double at;
+} Event;
+
+Event event(int thread, int i) {
+    return (Event){ thread, i, i % 3 ? "event" : NULL, thread + i / 1000.0 };
+}
+
+void* producer(void* arg) {
+    int thread = (int)(intptr_t)arg;
+    for (int i = 0; i < EVENTS; ++i) {
+        Event e = event(thread, i);
+        Event_log(&e);
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) return 1;
+    int fd = open(argv[1], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || !cerdeb_async_start(fd, CERDEB_ASYNC_BINARY)) return 1;
+    CHECK(!cerdeb_async_start(fd, CERDEB_ASYNC_BINARY));
+
+    for (int t = 0; t < THREADS; ++t) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, producer, (void*)(intptr_t)t) != 0) return 1;
+        pthread_join(thread, NULL);
+
+        for (int i = 0; i < EVENTS; ++i) {
+            Event e = event(t, i);
+            printf("%s\n", Event_debug_print(&e));
+        }
+        temp_reset();
+    }
+
+    cerdeb_async_stop();
+    cerdeb_async_stop();
+    CHECK(cerdeb_async_dropped() == 0);
+    close(fd);
+    return TEST_RESULT;
+}
@@ -0,0 +1,71 @@
+// Name_debug_print_cached formats a value only if none of the last
+// CERDEB_CACHE_SLOTS it printed hash the same
+
+#define NOB_STRIP_PREFIX
+#define NOB_IMPLEMENTATION
+#include "nob.h"
+#include "test.h"
+
+!cache
+typedef struct {
+    char* label;
+    int rank;
+} Tag;
+
+!cache
+typedef struct {
+    int id;
+    char* name;
+    Tag tag;
+} Item;
+
+// a hit gives back the very text of the earlier print, marked here
+const char* marked(const Item* item) {
+    char* text = (char*)Item_debug_print_cached(item);
+    text[0] = '#';
+    return text;
+}
+
+bool hit(const Item* item) {
+    return Item_debug_print_cached(item)[0] == '#';
+}
+
+int main(void) {
+    char name[] = "widget";
+    char label[] = "new";
+    Item item = { 1, name, { label, 3 } };
+    const char* expected = Item_debug_print(&item);
+
+    CHECK_STR(Item_debug_print_cached(&item), expected);
+    marked(&item);
+    CHECK(hit(&item));
+
+    // a field, a string it points to or one of a nested struct
+    item.id = 2;
+    CHECK(!hit(&item));
+    CHECK_STR(Item_debug_print_cached(&item), Item_debug_print(&item));
+    item.id = 1;
+    CHECK(hit(&item));
+
+    name[0] = 'W';
+    CHECK(!hit(&item));
+    CHECK_STR(Item_debug_print_cached(&item), Item_debug_print(&item));
+    name[0] = 'w';
+
+    label[0] = 'N';
+    CHECK(!hit(&item));
+    CHECK_STR(Item_debug_print_cached(&item), Item_debug_print(&item));
+    label[0] = 'n';
+
+    // the oldest value is evicted by the one past CERDEB_CACHE_SLOTS
+    Item items[CERDEB_CACHE_SLOTS + 1];
+    for (int i = 0; i < CERDEB_CACHE_SLOTS + 1; ++i) items[i] = (Item){ 100 + i, name, { label, i } };
+    for (int i = 0; i < CERDEB_CACHE_SLOTS; ++i) marked(&items[i]);
+    for (int i = 0; i < CERDEB_CACHE_SLOTS; ++i) CHECK(hit(&items[i]));
+    CHECK_STR(Item_debug_print_cached(&items[CERDEB_CACHE_SLOTS]), Item_debug_print(&items[CERDEB_CACHE_SLOTS]));
+    for (int i = 1; i < CERDEB_CACHE_SLOTS; ++i) CHECK(hit(&items[i]));
+    CHECK(!hit(&items[0]));
+    CHECK_STR(Item_debug_print_cached(&items[0]), Item_debug_print(&items[0]));
+
+    return TEST_RESULT;
+}
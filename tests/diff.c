@@ -0,0 +1,80 @@
+// Name_debug_diff prints the fields that changed and Name_debug_equal tells
+// whether there are any
+
+#define NOB_STRIP_PREFIX
+#define NOB_IMPLEMENTATION
+#include "nob.h"
+#include "test.h"
+
+!debug
+typedef enum {
+    OFF,
+    ON,
+} Power;
+
+!debug
+typedef struct {
+    int x;
+    int y;
+} Point;
+
+!debug
+typedef struct {
+    int id;
+    Point at;
+    Power power;
+    char* name;
+    char tag[8];
+    int xs[4];
+    double speed;
+    !skip int cache;
+} Robot;
+
+// longer than CERDEB_ARRAY_CAP
+!debug
+typedef struct {
+    int samples[20];
+    char* labels[20];
+} Series;
+
+int main(void) {
+    Robot a = { .id = 1, .at = { 2, 3 }, .power = ON, .name = "r2", .tag = "astro", .xs = { 1, 2, 3, 4 }, .speed = 1.5 };
+    Robot b = a;
+    b.cache = 42;
+
+    CHECK(Robot_debug_equal(&a, &b));
+    CHECK_STR(Robot_debug_diff(&a, &b), "Robot { }");
+
+    // an equal string at another address is no change
+    char name[] = "r2";
+    b.name = name;
+    CHECK(Robot_debug_equal(&a, &b));
+
+    b.at.y = 4;
+    b.power = OFF;
+    b.xs[3] = 5;
+    b.speed = 2.0;
+    CHECK(!Robot_debug_equal(&a, &b));
+    CHECK_STR(Robot_debug_diff(&a, &b), "Robot { .at = Point { .y = 3 -> 4 }, .power = ON -> OFF, .xs = [1, 2, 3, 4] -> [1, 2, 3, 5], .speed = 1.5 -> 2.0 }");
+    CHECK(strlen(Robot_debug_diff(&a, &b)) <= Robot_debug_max_len_diff(&a, &b));
+
+    b = a;
+    b.name = NULL;
+    strcpy(b.tag, "beep");
+    CHECK(!Robot_debug_equal(&a, &b));
+    CHECK_STR(Robot_debug_diff(&a, &b), "Robot { .name = r2 -> (null), .tag = astro -> beep }");
+
+    // arrays are compared whole, past the elements they print too
+    Series s = {0};
+    for (int i = 0; i < 20; ++i) s.labels[i] = "l";
+    Series t = s;
+    t.samples[18] = 1;
+    t.labels[19] = "m";
+    CHECK(!Series_debug_equal(&s, &t));
+    CHECK_STR(Series_debug_diff(&s, &t), "Series { .samples = [...] -> [...], .labels = [...] -> [...] }");
+    t.samples[1] = 1;
+    CHECK(strstr(Series_debug_diff(&s, &t), ".samples = [0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ...] -> [0, 1, 0, ") != NULL);
+    CHECK(strlen(Series_debug_diff(&s, &t)) <= Series_debug_max_len_diff(&s, &t));
+
+    return TEST_RESULT;
+}
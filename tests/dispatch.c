@@ -0,0 +1,46 @@
+// cerdeb_debug picks the printer of the type of its pointer at compile time
+
+#define NOB_STRIP_PREFIX
+#define NOB_IMPLEMENTATION
+#include "nob.h"
+#include "test.h"
+
+!debug
+typedef struct {
+    int x;
+    int y;
+} Point;
+
+!debug
+typedef struct {
+    Point from;
+    Point to;
+} Line;
+
+!debug
+typedef struct Named {
+    char* name;
+    double weight;
+} Named;
+
+!log
+typedef struct {
+    unsigned id;
+} Logged;
+
+int main(void) {
+    Point point = { 1, 2 };
+    Line line = { { 0, 0 }, { 3, 4 } };
+    struct Named named = { "anvil", 50.5 };
+    Logged logged = { 7 };
+    const Point* constant = &point;
+
+    CHECK_STR(cerdeb_debug(&point), "Point { .x = 1, .y = 2 }");
+    CHECK_STR(cerdeb_debug(&line), "Line { .from = Point { .x = 0, .y = 0 }, .to = Point { .x = 3, .y = 4 } }");
+    CHECK_STR(cerdeb_debug(&named), "Named { .name = anvil, .weight = 50.5 }");
+    CHECK_STR(cerdeb_debug(&logged), "Logged { .id = 7 }");
+    CHECK_STR(cerdeb_debug(constant), "Point { .x = 1, .y = 2 }");
+    CHECK_STR(cerdeb_debug(&line.to), "Point { .x = 3, .y = 4 }");
+
+    return TEST_RESULT;
+}
@@ -0,0 +1,61 @@
+// The flight recorder keeps the last SLOTS records, across a reopening of
+// the file too, which the program prints on stdout before it dies without
+// closing the recorder
+
+#include <stdint.h>
+#include <unistd.h>
+
+#define NOB_STRIP_PREFIX
+#define NOB_IMPLEMENTATION
+#include "nob.h"
+#include "test.h"
+
+#define SLOTS 64
+#define SLOT_SIZE 128
+#define RECORDS 1000
+
+!log
+typedef struct {
+    uint64_t seq;
+    int code;
+    char* message;
+} Snapshot;
+
+Snapshot snapshot(int i) {
+    static const char* messages[] = { "ok", "retry", NULL };
+    return (Snapshot){ (uint64_t)i, -i, (char*)messages[i % 3] };
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) return 1;
+
+    // a file of the same size but other slots is started over
+    if (!cerdeb_flight_open(argv[1], SLOTS / 2, SLOT_SIZE * 2)) return 1;
+    Snapshot_flight(&(Snapshot){ .message = "lost" });
+    cerdeb_flight_close();
+
+    if (!cerdeb_flight_open(argv[1], SLOTS, SLOT_SIZE)) return 1;
+    CHECK(!cerdeb_flight_open(argv[1], SLOTS, SLOT_SIZE));
+
+    for (int i = 0; i < RECORDS; ++i) {
+        // like a restart, the last records of the ring come from both runs
+        if (i == RECORDS - SLOTS / 2) {
+            cerdeb_flight_close();
+            if (!cerdeb_flight_open(argv[1], SLOTS, SLOT_SIZE)) return 1;
+        }
+
+        Snapshot s = snapshot(i);
+        Snapshot_flight(&s);
+        if (i >= RECORDS - SLOTS) printf("%s\n", Snapshot_debug_print(&s));
+
+        // too big for a slot, left out without taking one
+        char big[SLOT_SIZE];
+        memset(big, 'x', sizeof(big) - 1);
+        big[sizeof(big) - 1] = '\0';
+        Snapshot_flight(&(Snapshot){ .message = big });
+    }
+
+    // the records are in the file without cerdeb_flight_close, like after a crash
+    fflush(stdout);
+    _exit(TEST_RESULT);
+}
@@ -0,0 +1,49 @@
+// !follow prints the pointers to derived structs in place and the others,
+// which have no printer, as addresses
+
+#include <stdio.h>
+
+#define NOB_STRIP_PREFIX
+#define NOB_IMPLEMENTATION
+#include "nob.h"
+#include "test.h"
+
+// not derived
+typedef struct {
+    int secret;
+} Opaque;
+
+!follow
+typedef struct Node {
+    int value;
+    struct Node* next;
+    FILE* file;
+    Opaque* opaque;
+    void* data;
+} Node;
+
+!follow
+typedef struct {
+    Node* head;
+    size_t count;
+} List;
+
+int main(void) {
+    Opaque opaque = { 42 };
+    Node b = { .value = 2, .file = (FILE*)0x20, .opaque = &opaque };
+    Node a = { .value = 1, .next = &b, .file = (FILE*)0x10, .data = (void*)0x30 };
+    b.next = &a;
+    List list = { &a, 2 };
+
+    char* expected = temp_sprintf(
+        "List { .head = &Node { .value = 1, .next = &Node { .value = 2, .next = %p (seen), .file = %p, .opaque = %p, .data = (nil) }, "
+        ".file = %p, .opaque = (nil), .data = %p }, .count = 2 }",
+        (void*)&a, (void*)0x20, (void*)&opaque, (void*)0x10, (void*)0x30);
+    CHECK_STR(List_debug_print(&list), expected);
+    CHECK(strlen(List_debug_print(&list)) <= List_debug_max_len(&list));
+
+    list.head = NULL;
+    CHECK_STR(List_debug_print(&list), "List { .head = (nil), .count = 2 }");
+
+    return TEST_RESULT;
+}
@@ -0,0 +1,117 @@
+// The records of the log macros that pass the compile-time CERDEB_LEVEL and
+// the runtime cerdeb_level, as they reach cerdeb_sink
+
+#define NOB_STRIP_PREFIX
+#define NOB_IMPLEMENTATION
+#include "nob.h"
+#include "test.h"
+
+// CERDEB_TRACE is stripped
+#define CERDEB_LEVEL CERDEB_LEVEL_DEBUG
+
+!debug
+typedef struct {
+    int x;
+} Ev;
+
+// more than the stack buffer of the emitter
+!debug
+typedef struct {
+    char text[600];
+} Big;
+
+String_Builder sunk = {0};
+int sunk_levels = 0; // a bit per level
+
+void sink(int level, const char* text, size_t len) {
+    sb_append_buf(&sunk, text, len);
+    sunk_levels |= 1 << level;
+}
+
+// what reached the sink since the last call
+const char* take_sunk(void) {
+    const char* text = temp_sprintf("%.*s", (int)sunk.count, sunk.items);
+    sunk.count = 0;
+    return text;
+}
+
+int evaluated = 0;
+
+Ev* counted(Ev* ev) {
+    evaluated += 1;
+    return ev;
+}
+
+size_t formatted = 0;
+Cerdeb_Write ev_write = NULL;
+
+char* counting_write(char* p, const void* ptr) {
+    formatted += 1;
+    return ev_write(p, ptr);
+}
+
+int main(void) {
+    cerdeb_sink = sink;
+    Ev ev = { 1 };
+
+    CHECK(cerdeb_level == CERDEB_LEVEL_DEBUG);
+    CERDEB_ERROR(Ev, &ev);
+    CERDEB_WARN(Ev, &ev);
+    CERDEB_INFO(Ev, &ev);
+    CERDEB_DEBUG(Ev, &ev);
+    CERDEB_TRACE(Ev, &ev);
+    CHECK_STR(take_sunk(), "ERROR Ev { .x = 1 }\nWARN Ev { .x = 1 }\nINFO Ev { .x = 1 }\nDEBUG Ev { .x = 1 }\n");
+    CHECK(sunk_levels == (1 << CERDEB_LEVEL_ERROR | 1 << CERDEB_LEVEL_WARN | 1 << CERDEB_LEVEL_INFO | 1 << CERDEB_LEVEL_DEBUG));
+
+    // not even a runtime level above CERDEB_LEVEL brings CERDEB_TRACE back,
+    // and it doesn't evaluate its pointer
+    cerdeb_level = CERDEB_LEVEL_TRACE;
+    CERDEB_TRACE(Ev, counted(&ev));
+    CHECK_STR(take_sunk(), "");
+    CHECK(evaluated == 0);
+
+    // the ones disabled at runtime don't evaluate their pointer either
+    cerdeb_level = CERDEB_LEVEL_WARN;
+    ev.x = 2;
+    CERDEB_ERROR(Ev, counted(&ev));
+    CERDEB_WARN(Ev, counted(&ev));
+    CERDEB_INFO(Ev, counted(&ev));
+    CERDEB_DEBUG(Ev, counted(&ev));
+    CHECK_STR(take_sunk(), "ERROR Ev { .x = 2 }\nWARN Ev { .x = 2 }\n");
+    CHECK(evaluated == 2);
+
+    // a lazy handle is only formatted if its level is enabled
+    Cerdeb_Lazy lazy = Ev_debug_lazy(&ev);
+    ev_write = lazy.write;
+    lazy.write = counting_write;
+    cerdeb_level = CERDEB_LEVEL_INFO;
+    cerdeb_emit_lazy(CERDEB_LEVEL_DEBUG, lazy);
+    CHECK(formatted == 0);
+    CHECK_STR(take_sunk(), "");
+    cerdeb_emit_lazy(CERDEB_LEVEL_INFO, lazy);
+    CHECK(formatted == 1);
+    CHECK_STR(take_sunk(), "INFO Ev { .x = 2 }\n");
+
+    static Big big;
+    memset(big.text, 'b', sizeof(big.text) - 1);
+    cerdeb_emit_lazy(CERDEB_LEVEL_ERROR, Big_debug_lazy(&big));
+    CHECK_STR(take_sunk(), temp_sprintf("ERROR %s\n", Big_debug_print(&big)));
+
+    // the first of every 3 calls, counted from the first one of the site
+    for (ev.x = 0; ev.x < 10; ++ev.x) CERDEB_EVERY_N(CERDEB_LEVEL_INFO, 3, Ev, &ev);
+    CHECK_STR(take_sunk(), "INFO Ev { .x = 0 }\nINFO Ev { .x = 3 }\nINFO Ev { .x = 6 }\nINFO Ev { .x = 9 }\n");
+    for (ev.x = 0; ev.x < 10; ++ev.x) CERDEB_EVERY_N(CERDEB_LEVEL_DEBUG, 3, Ev, counted(&ev));
+    CHECK_STR(take_sunk(), "");
+    CHECK(evaluated == 2);
+
+    // 5 a second, 10 if the loop happens to cross a second
+    for (ev.x = 0; ev.x < 1000; ++ev.x) CERDEB_RATE(CERDEB_LEVEL_WARN, 5, Ev, &ev);
+    const char* rated = take_sunk();
+    size_t lines = 0;
+    for (const char* c = rated; *c; ++c) lines += *c == '\n';
+    CHECK(lines >= 5 && lines <= 10);
+    CHECK(strncmp(rated, "WARN Ev { .x = 0 }\nWARN Ev { .x = 1 }\n", 38) == 0);
+
+    sb_free(sunk);
+    return TEST_RESULT;
+}
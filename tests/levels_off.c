@@ -0,0 +1,55 @@
+// With CERDEB_LEVEL_OFF the text printers are left out and the log macros do
+// nothing, the binary log still works
+
+#define NOB_STRIP_PREFIX
+#define NOB_IMPLEMENTATION
+#include "nob.h"
+#include "test.h"
+
+#define CERDEB_LEVEL CERDEB_LEVEL_OFF
+
+!log
+typedef struct {
+    int x;
+    char* s;
+} Ev;
+
+// would clash with the generated printer
+char* Ev_debug_print(const Ev* ev) {
+    return temp_sprintf("Ev { .x = %d, .s = %s }", ev->x, ev->s);
+}
+
+int evaluated = 0;
+
+Ev* counted(Ev* ev) {
+    evaluated += 1;
+    return ev;
+}
+
+void sink(int level, const char* text, size_t len) {
+    (void)level;
+    (void)text;
+    (void)len;
+    CHECK(!"a record reached the sink");
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || !cerdeb_log_open(argv[1])) return 1;
+    cerdeb_sink = sink;
+    cerdeb_level = CERDEB_LEVEL_TRACE;
+
+    Ev ev = { 1, "one" };
+    CERDEB_ERROR(Ev, counted(&ev));
+    CERDEB_TRACE(Ev, counted(&ev));
+    CERDEB_EVERY_N(CERDEB_LEVEL_ERROR, 1, Ev, counted(&ev));
+    CERDEB_RATE(CERDEB_LEVEL_ERROR, 100, Ev, counted(&ev));
+    CHECK(evaluated == 0);
+
+    for (ev.x = 0; ev.x < 10; ++ev.x) {
+        Ev_log(&ev);
+        printf("%s\n", Ev_debug_print(&ev));
+    }
+
+    cerdeb_log_close();
+    return TEST_RESULT;
+}
@@ -0,0 +1,98 @@
+// Every record logged to argv[1] is printed on stdout too, cerdeb-decode has
+// to give the same text for the log
+
+#include <stdint.h>
+
+#define NOB_STRIP_PREFIX
+#define NOB_IMPLEMENTATION
+#include "nob.h"
+#include "test.h"
+
+!debug
+typedef enum {
+    IDLE,
+    RUNNING,
+    STOPPED = 10,
+} State;
+
+!log
+typedef struct {
+    char* a;
+    char* b;
+    char* c;
+    char* d;
+} Strings;
+
+!log
+typedef struct {
+    char* s0; char* s1; char* s2; char* s3; char* s4; char* s5; char* s6; char* s7;
+    char* s8; char* s9; char* s10; char* s11; char* s12; char* s13; char* s14; char* s15;
+} Nulls;
+
+!log
+typedef struct {
+    int x;
+    double y;
+} Point;
+
+!log
+typedef struct {
+    Point at;
+    State state;
+    char name[8];
+    !max(3) char* tag;
+    !len(n) char* data;
+    size_t n;
+    !hex unsigned flags;
+    uint64_t big;
+    float f;
+    char c;
+    void* p;
+    int xs[20];
+} Record;
+
+void log_strings(Strings s) {
+    printf("%s\n", Strings_debug_print(&s));
+    Strings_log(&s);
+}
+
+void log_record(Record r) {
+    printf("%s\n", Record_debug_print(&r));
+    Record_log(&r);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || !cerdeb_log_open(argv[1])) return 1;
+
+    // a NULL string packs to less than the "(null)" it prints, the records of
+    // random length put the NULL ones at every offset of the decoder's buffer
+    static const char text[] = "a string long enough to be cut at any length up to a hundred bytes or so, in the log";
+    log_strings((Strings){0});
+    log_strings((Strings){ "a", NULL, "", NULL });
+    for (int i = 0; i < 2000; ++i) {
+        log_strings((Strings){ .a = (char*)text + test_random() % sizeof(text) });
+        Nulls nulls = {0};
+        printf("%s\n", Nulls_debug_print(&nulls));
+        Nulls_log(&nulls);
+        temp_reset();
+    }
+
+    Record r = { .at = { -1, 0.25 }, .state = RUNNING, .name = "abc", .tag = "long tag", .data = "hello", .n = 2,
+                 .flags = 0xbeef, .big = UINT64_MAX, .f = 1.5f, .c = 'z', .p = (void*)0x1000 };
+    for (int i = 0; i < 20; ++i) r.xs[i] = i * i;
+    log_record(r);
+
+    // NULL strings, an unnamed enum value and empty char arrays
+    r = (Record){ .state = (State)7, .c = 'c' };
+    log_record(r);
+    r.state = STOPPED;
+    for (int i = 0; i < 1000; ++i) {
+        r.at.x = (int)test_random();
+        r.big = test_random();
+        log_record(r);
+        temp_reset();
+    }
+
+    cerdeb_log_close();
+    return TEST_RESULT;
+}
@@ -0,0 +1,67 @@
+// The log buffers of the threads reach the log when the threads exit, and
+// cerdeb_log_close writes those of the threads that are still alive
+
+#include <pthread.h>
+
+#define NOB_STRIP_PREFIX
+#define NOB_IMPLEMENTATION
+#include "nob.h"
+#include "test.h"
+
+#define THREADS 4
+#define EVENTS 10
+
+!log
+typedef struct {
+    int t;
+    int i;
+} Ev;
+
+pthread_barrier_t logged;
+pthread_barrier_t closed;
+
+void* worker(void* arg) {
+    int t = (int)(intptr_t)arg;
+    for (int i = 0; i < EVENTS; ++i) Ev_log(&(Ev){ t, i });
+    return NULL;
+}
+
+// logs and waits for the log to be closed before exiting
+void* lingering(void* arg) {
+    worker(arg);
+    pthread_barrier_wait(&logged);
+    pthread_barrier_wait(&closed);
+    return NULL;
+}
+
+void print_events(int t, int count) {
+    for (int i = 0; i < count; ++i) printf("%s\n", Ev_debug_print(&(Ev){ t, i }));
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || !cerdeb_log_open(argv[1])) return 1;
+
+    // one thread after the other, their records in the order they exit
+    for (int t = 0; t < THREADS; ++t) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, worker, (void*)(intptr_t)t) != 0) return 1;
+        pthread_join(thread, NULL);
+        print_events(t, EVENTS);
+    }
+
+    Ev_log(&(Ev){ 99, 0 });
+    cerdeb_log_flush();
+    print_events(99, 1);
+
+    pthread_barrier_init(&logged, NULL, 2);
+    pthread_barrier_init(&closed, NULL, 2);
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, lingering, (void*)(intptr_t)THREADS) != 0) return 1;
+    pthread_barrier_wait(&logged);
+    print_events(THREADS, EVENTS);
+
+    cerdeb_log_close();
+    pthread_barrier_wait(&closed);
+    pthread_join(thread, NULL);
+    return TEST_RESULT;
+}
@@ -0,0 +1,259 @@
+// The text printers of the derived structs, field by field against printf
+// and strtod, and record by record against each other
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define NOB_STRIP_PREFIX
+#define NOB_IMPLEMENTATION
+#include "nob.h"
+#include "test.h"
+
+// several chunks for the parallel printer
+#define CERDEB_PARALLEL_CHUNK 64
+
+!debug
+typedef struct {
+    int i;
+    long long l;
+    unsigned u;
+    uint64_t big;
+    char c;
+    char* s;
+    void* p;
+} Scalars;
+
+!debug
+typedef struct {
+    double d;
+    float f;
+} Floats;
+
+!debug
+typedef struct {
+    int xs[20];
+    int small[3];
+    char name[8];
+} Arrays;
+
+!debug
+typedef struct {
+    !hex unsigned flags;
+    !len(n) char* data;
+    size_t n;
+    !max(4) char* msg;
+    !skip int secret;
+    int after;
+} Packet;
+
+!debug
+typedef struct {
+    char* key;
+    size_t key_len;
+    char* name;
+    size_t name_size;
+    char* s;
+    size_t len;
+} Key;
+
+!debug
+typedef enum {
+    LEFT,
+    RIGHT,
+} Side;
+
+// far more than the buffer of the signal-safe printer
+!debug
+typedef struct {
+    char text[1000];
+    !max(600) char* msg;
+    double ds[20];
+    Side sides[3];
+    Arrays arrays[2];
+    Packet packet;
+} Large;
+
+Scalars random_scalars(void) {
+    static const char* strings[] = { "", "a", "hello", "a longer string, with a comma" };
+    Scalars v = {
+        .i = (int)test_random(),
+        .l = (long long)test_random(),
+        .u = (unsigned)test_random(),
+        .big = test_random(),
+        .c = (char)('a' + test_random() % 26),
+        .s = (char*)strings[test_random() % 4],
+        .p = (void*)(uintptr_t)(test_random() | 1),
+    };
+    // small values take the other branches of the integer formatter
+    if (test_random() % 2) v.i >>= test_random() % 32;
+    if (test_random() % 2) v.l >>= test_random() % 64;
+    return v;
+}
+
+void check_scalars(Scalars v) {
+    char expected[256];
+    snprintf(expected, sizeof(expected), "Scalars { .i = %d, .l = %lld, .u = %u, .big = %llu, .c = %c, .s = %s, .p = %p }",
+             v.i, v.l, v.u, (unsigned long long)v.big, v.c, v.s, v.p);
+    char* actual = Scalars_debug_print(&v);
+    CHECK_STR(actual, expected);
+    CHECK(strlen(actual) <= Scalars_debug_max_len(&v));
+}
+
+// the significant digits of the number at `s`
+size_t digits(const char* s) {
+    const char* first = NULL;
+    const char* last = NULL;
+    for (; *s && *s != 'e' && *s != ',' && *s != ' '; ++s) {
+        if (*s < '0' || *s > '9') continue;
+        if (first == NULL && *s != '0') first = s;
+        if (*s != '0') last = s;
+    }
+    if (first == NULL) return 1;
+
+    size_t n = 0;
+    for (const char* c = first; c <= last; ++c) n += *c >= '0' && *c <= '9';
+    return n;
+}
+
+// the text parses back to the same value, with no more digits than needed for any value
+void check_floats(double d, float f) {
+    int failures = test_failures;
+    Floats v = { d, f };
+    char* text = Floats_debug_print(&v);
+    CHECK(strlen(text) <= FLOATS_DEBUG_MAX_LEN);
+
+    const char* d_text = strstr(text, ".d = ") + 5;
+    const char* f_text = strstr(text, ".f = ") + 5;
+    CHECK(strtod(d_text, NULL) == d);
+    CHECK(strtof(f_text, NULL) == f);
+    CHECK(digits(d_text) <= 17);
+    CHECK(digits(f_text) <= 9);
+    if (test_failures != failures) fprintf(stderr, "    in %s (%.17g, %.9g)\n", text, d, f);
+}
+
+// what `write` wrote to a file
+char* written(void (*write)(int fd, const void* arg), const void* arg) {
+    FILE* file = tmpfile();
+    write(fileno(file), arg);
+    long size = lseek(fileno(file), 0, SEEK_END);
+    char* text = temp_alloc(size + 1);
+    pread(fileno(file), text, size, 0);
+    text[size] = '\0';
+    fclose(file);
+    return text;
+}
+
+void write_signal_safe(int fd, const void* arg) {
+    Scalars_debug_write_signal_safe(fd, arg);
+}
+
+void write_large_signal_safe(int fd, const void* arg) {
+    Large_debug_write_signal_safe(fd, arg);
+}
+
+#define MANY 1000
+Scalars many[MANY];
+
+void write_parallel(int fd, const void* arg) {
+    (void)arg;
+    CHECK(Scalars_debug_fd_print_many(fd, many, MANY, 4));
+}
+
+int main(void) {
+    check_scalars((Scalars){ INT32_MIN, INT64_MIN, 0, UINT64_MAX, 'x', "", (void*)1 });
+    check_scalars((Scalars){ INT32_MAX, INT64_MAX, UINT32_MAX, 0, 'y', "s", (void*)UINTPTR_MAX });
+    for (size_t i = 0; i < 10000; ++i) {
+        check_scalars(random_scalars());
+        temp_reset();
+    }
+
+    Scalars null_string = { .c = 'c', .s = NULL, .p = NULL };
+    CHECK_STR(Scalars_debug_print(&null_string), "Scalars { .i = 0, .l = 0, .u = 0, .big = 0, .c = c, .s = (null), .p = (nil) }");
+
+    Floats exact = { 0.1, 0.5f };
+    CHECK_STR(Floats_debug_print(&exact), "Floats { .d = 0.1, .f = 0.5 }");
+    exact = (Floats){ 1.5e300, 1e-7f };
+    CHECK_STR(Floats_debug_print(&exact), "Floats { .d = 1.5e300, .f = 1e-7 }");
+    exact = (Floats){ 123.456, 1.0f };
+    CHECK_STR(Floats_debug_print(&exact), "Floats { .d = 123.456, .f = 1.0 }");
+    check_floats(5e-324, 1e-45f);
+    check_floats(1.7976931348623157e308, 3.4028235e38f);
+    for (size_t i = 0; i < 10000; ++i) {
+        uint64_t bits = test_random();
+        uint32_t fbits = (uint32_t)test_random();
+        double d;
+        float f;
+        memcpy(&d, &bits, 8);
+        memcpy(&f, &fbits, 4);
+        if (isfinite(d) && isfinite(f)) check_floats(d, f);
+        check_floats((double)(test_random() % 1000000) / 1000, (float)(test_random() % 100000) / 100);
+        temp_reset();
+    }
+
+    // the first CERDEB_ARRAY_CAP elements, a char array up to its zero byte or its end
+    Arrays arrays = { .small = { -1, 0, 1 }, .name = "abc" };
+    for (int i = 0; i < 20; ++i) arrays.xs[i] = i;
+    CHECK_STR(Arrays_debug_print(&arrays), "Arrays { .xs = [0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, ...], "
+              ".small = [-1, 0, 1], .name = abc }");
+    memcpy(arrays.name, "abcdefgh", 8);
+    CHECK(strstr(Arrays_debug_print(&arrays), ".name = abcdefgh }") != NULL);
+    CHECK(strlen(Arrays_debug_print(&arrays)) <= ARRAYS_DEBUG_MAX_LEN);
+
+    Packet packet = { .flags = 0xbeef, .data = "hello world", .n = 5, .msg = "truncated", .secret = 42, .after = 1 };
+    CHECK_STR(Packet_debug_print(&packet), "Packet { .flags = 0xbeef, .data = hello, .n = 5, .msg = trun, .after = 1 }");
+    CHECK(strlen(Packet_debug_print(&packet)) <= PACKET_DEBUG_MAX_LEN);
+    packet.data = NULL;
+    packet.msg = NULL;
+    CHECK_STR(Packet_debug_print(&packet), "Packet { .flags = 0xbeef, .data = (null), .n = 5, .msg = (null), .after = 1 }");
+
+    // a char* before its length prints that many characters
+    Key key = { .key = "keyboard", .key_len = 3, .name = "abcdef", .name_size = 2, .s = "xyz", .len = 1 };
+    CHECK_STR(Key_debug_print(&key), "Key { .key = key, .key_len = 3, .name = ab, .name_size = 2, .s = x, .len = 1 }");
+    key.key = NULL;
+    CHECK(strstr(Key_debug_print(&key), ".key = (null), .key_len = 3") != NULL);
+
+    // the batch printers give the records of the single one, a line each
+    // with the extremes in the SIMD columns too
+    String_Builder expected = {0};
+    for (size_t i = 0; i < MANY; ++i) {
+        many[i] = random_scalars();
+        if (i % 100 == 7) many[i] = (Scalars){ INT32_MIN, INT64_MIN, 0, UINT64_MAX, 'x', "", (void*)1 };
+        if (i % 100 == 8) many[i] = (Scalars){ INT32_MAX, INT64_MAX, UINT32_MAX, 0, 'y', NULL, NULL };
+        sb_append_cstr(&expected, Scalars_debug_print(&many[i]));
+        sb_append_cstr(&expected, "\n");
+    }
+    sb_append_null(&expected);
+    CHECK(strcmp(Scalars_debug_print_many(many, MANY), expected.items) == 0);
+    CHECK(strcmp(written(write_parallel, NULL), expected.items) == 0);
+    sb_free(expected);
+
+    // past nob's temporary storage the printers give NULL rather than overflow it
+    static Scalars huge[100000];
+    temp_reset();
+    CHECK(Scalars_debug_print_many(huge, ARRAY_LEN(huge)) == NULL);
+    CHECK(Scalars_debug_print(&huge[0]) != NULL);
+
+    for (size_t i = 0; i < 100; ++i) {
+        char* line = temp_sprintf("%s\n", Scalars_debug_print(&many[i]));
+        CHECK_STR(written(write_signal_safe, &many[i]), line);
+    }
+
+    // through a buffer of CERDEB_SIGNAL_SAFE_BUF bytes
+    static Large large;
+    static char message[700];
+    memset(large.text, 't', sizeof(large.text));
+    memset(message, 'm', sizeof(message) - 1);
+    large.msg = message;
+    for (int i = 0; i < 20; ++i) large.ds[i] = 1.0 / (i + 3);
+    large.sides[1] = RIGHT;
+    large.arrays[1] = arrays;
+    large.packet = (Packet){ .flags = 0xbeef, .data = "hello", .n = 5, .after = 1 };
+    CHECK_STR(written(write_large_signal_safe, &large), temp_sprintf("%s\n", Large_debug_print(&large)));
+    large.text[10] = '\0';
+    large.msg = NULL;
+    CHECK_STR(written(write_large_signal_safe, &large), temp_sprintf("%s\n", Large_debug_print(&large)));
+
+    return TEST_RESULT;
+}
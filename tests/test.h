@@ -0,0 +1,39 @@
+// test.h - checks shared by the tests of cerdeb
+//
+// A test reports every failed check on stderr and exits with the number of
+// failures from main through TEST_RESULT.
+
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <stdio.h>
+#include <string.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) check((cond), __FILE__, __LINE__, #cond)
+#define CHECK_STR(actual, expected) check_str((actual), (expected), __FILE__, __LINE__)
+#define TEST_RESULT (test_failures > 255 ? 255 : test_failures)
+
+static inline void check(int ok, const char* file, int line, const char* what) {
+    if (ok) return;
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+    test_failures += 1;
+}
+
+static inline void check_str(const char* actual, const char* expected, const char* file, int line) {
+    if (strcmp(actual, expected) == 0) return;
+    fprintf(stderr, "%s:%d: expected\n    %s\nbut got\n    %s\n", file, line, expected, actual);
+    test_failures += 1;
+}
+
+// xorshift64*, the tests are reproducible
+static inline unsigned long long test_random(void) {
+    static unsigned long long x = 0x9E3779B97F4A7C15ull;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+#endif // TEST_H_